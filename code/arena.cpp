@@ -0,0 +1,111 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+static ArenaBlock *make_block(u64 capacity)
+{
+    ArenaBlock *block = (ArenaBlock*)malloc(sizeof(ArenaBlock) + capacity);
+    if (!block) return null;
+    block->next = null;
+    block->capacity = capacity;
+    block->used = 0;
+    return block;
+}
+
+inline char *block_memory(ArenaBlock *block)
+{
+    return (char*)(block + 1);
+}
+
+void *Arena::allocate(u64 size)
+{
+    // keep every allocation 8 bytes aligned
+    size = (size + 7) & ~7ull;
+
+    if (!current || (current->used + size > current->capacity))
+    {
+        // blocks behind 'current' are left over from before a reset
+        ArenaBlock *next = current ? current->next : first;
+        if (next && (size <= next->capacity))
+        {
+            next->used = 0;
+            current = next;
+        }
+        else
+        {
+            u64 capacity = block_size;
+            if (size > capacity) capacity = size;
+
+            ArenaBlock *block = make_block(capacity);
+            if (!block) return null;
+
+            block->next = next;
+            if (current) current->next = block;
+            else first = block;
+            current = block;
+        }
+    }
+
+    void *result = block_memory(current) + current->used;
+    current->used += size;
+    return result;
+}
+
+char *Arena::copy_string(const char *data, u64 length)
+{
+    char *result = (char*)allocate(length + 1);
+    if (!result) return null;
+    memcpy(result, data, length);
+    result[length] = 0;
+    return result;
+}
+
+void Arena::shrink_last(void *memory, u64 old_size, u64 new_size)
+{
+    old_size = (old_size + 7) & ~7ull;
+    new_size = (new_size + 7) & ~7ull;
+
+    // only the allocation at the top of the current block can shrink
+    char *top = block_memory(current) + current->used;
+    if ((char*)memory + old_size != top) return;
+    current->used -= old_size - new_size;
+}
+
+void Arena::take_blocks(Arena *other)
+{
+    if (!other->first) return;
+
+    if (!first)
+    {
+        first = other->first;
+    }
+    else
+    {
+        ArenaBlock *last = current;
+        while (last->next) last = last->next;
+        last->next = other->first;
+    }
+    current = other->current;
+
+    other->first = null;
+    other->current = null;
+}
+
+void Arena::reset(void)
+{
+    current = first;
+    if (current) current->used = 0;
+}
+
+void Arena::release(void)
+{
+    ArenaBlock *block = first;
+    while (block)
+    {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    first = null;
+    current = null;
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "common.h"
+
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+struct ArenaBlock
+{
+    ArenaBlock *next = null;
+    u64 capacity = 0;
+    u64 used = 0;
+    // block memory follows the header
+};
+
+// @note memory is handed out from a list of blocks that are never moved,
+// so pointers stay valid until the arena is released
+struct Arena
+{
+    ArenaBlock *first   = null;
+    ArenaBlock *current = null;
+    u64 block_size = ARENA_DEFAULT_BLOCK_SIZE;
+
+    void *allocate(u64 size);
+    char *copy_string(const char *data, u64 length);
+    // gives back the end of the most recent allocation
+    void shrink_last(void *memory, u64 old_size, u64 new_size);
+    // moves all blocks of 'other' into this arena, their memory stays where it is
+    void take_blocks(Arena *other);
+    // O(1), everything allocated so far is invalid, the blocks are kept for reuse
+    void reset(void);
+    void release(void);
+};
\ No newline at end of file
@@ -0,0 +1,1144 @@
+#include "lexer.h"
+#include "platform.h"
+#include "char_class.h"
+#include "intern.h"
+#include "stream.h"
+#include "cache.h"
+#include "corpus.h"
+#include "instrument.h"
+#include "lookahead.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+
+#define BENCH_RUNS 5
+#define BENCH_CACHE_PATH "lexer_bench.tokens"
+// small inputs are lexed again and again until a sample covers at least this many bytes
+#define SUITE_MIN_SAMPLE_BYTES (64ull * 1024 * 1024)
+
+static const char *corpus_snippet = R"(
+/**
+ * square function:
+ * x: float
+ * returns float
+*/
+function square(x: float): float
+{
+    return x * x;
+}
+
+// main entry point
+function main()
+{
+    result: int = cast(int)square( cast(float) 2 );
+    mask := 0xFF_00 | 0b1010;
+    scale := 1.5e+3 * .25;
+    if result >= 10 && result != 42 then print("result: %d\n", result);
+    for i: 0..10 { total += i << 2; }
+}
+)";
+
+// mostly whitespace and comments, like our generated sources
+static const char *comment_snippet = R"(
+/*
+ * ---------------------------------------------------------------------
+ * generated table, do not edit by hand
+ * ---------------------------------------------------------------------
+ */
+                                                            // padding
+        {
+                entry: u32 = 1;                              // first entry
+                                                              
+                                                              
+                entry_next: u32 = 2;                         // second entry
+        }
+)";
+
+// identifiers and keywords only, stresses check_for_keyword
+static const char *identifier_snippet = R"(
+result value count index for while return entry_next table_size cast inline
+struct buffer length capacity if else then switch case defer u32 s64 float
+alias name data cursor token lexer input output string continue break using
+undefined function operator auto_cast no_inline size_of extern union bool void
+)";
+
+// long literals, like our generated data tables
+static const char *number_snippet = R"(
+    { 1234567890123, 0xDEAD_BEEF_CAFE_F00D, 0b1011_0110_1110_0001, 3.14159265358979, 100_000_000 },
+    { 9876543210, 0x7fffffffffffffff, 0b11111111000000001111, 2.718281828459045, 42 },
+)";
+
+// the main snippet with two lexical errors in it, the same number of tokens in recovery mode
+static const char *error_snippet = R"(
+/**
+ * square function:
+ * x: float
+ * returns float
+*/
+function square(x: float): float
+{
+    return x * x;
+}
+
+// main entry point
+function main()
+{
+    result: int = cast(int)square( cast(float) 2 );
+    mask := 0xFF_00 | 0b1010;
+    scale := 1.5.3 * .25;
+    if result >= 10 && result != 42 then print("result: %d\q", result);
+    for i: 0..10 { total += i << 2; }
+}
+)";
+
+static String make_corpus(const char *snippet, u64 wanted_size)
+{
+    u64 snippet_length = strlen(snippet);
+
+    String result;
+    result.data = (char*)calloc(1, wanted_size + snippet_length + LEXER_INPUT_PADDING);
+    while (result.length < wanted_size)
+    {
+        memcpy(result.data + result.length, snippet, snippet_length);
+        result.length += snippet_length;
+    }
+    return result;
+}
+
+static void report(const char *name, String corpus, s64 token_count, f64 seconds)
+{
+    f64 megabytes = (f64)corpus.length / (1024.0 * 1024.0);
+    fprintf(stdout, "%-16s %10.2f MB/s %14.0f tokens/s\n",
+            name, megabytes / seconds, (f64)token_count / seconds);
+}
+
+static s64 run_pull_loop(String corpus)
+{
+    Lexer lexer;
+    lexer.initialize(corpus, true);
+
+    s64 count = 0;
+    while (true)
+    {
+        Token *t = lexer.peek_next_token();
+        count += 1;
+        if (t->type == TokenType_END_OF_FILE) break;
+        lexer.eat_token();
+    }
+    lexer.deinitialize();
+    return count;
+}
+
+// a parser that tries declarations ('name: type = ...') and backs up when it was something else
+static s64 run_lookahead(String corpus)
+{
+    LookaheadLexer<16> lexer;
+    lexer.initialize(corpus, true);
+
+    s64 count = 0;
+    while (true)
+    {
+        Token *t = lexer.peek();
+        if (t->type == TokenType_END_OF_FILE) break;
+        if ((t->type == TokenType_IDENTIFIER) && (lexer.peek(1)->type == ':'))
+        {
+            TokenMark mark = lexer.mark();
+            for (int i = 0; (i < 6) && (lexer.peek()->type != TokenType_END_OF_FILE); ++i) lexer.eat();
+            lexer.rewind(mark);
+        }
+        lexer.eat();
+        count += 1;
+    }
+    lexer.deinitialize();
+    return count + 1;
+}
+
+// reused between runs, like a front-end lexing file after file
+static TokenArray bench_tokens;
+
+static s64 run_tokenize_all(String corpus)
+{
+    bench_tokens.count = 0;
+    tokenize_all(corpus, &bench_tokens, true);
+    return bench_tokens.count;
+}
+
+// offsets only, the line table is built once at the end as if a diagnostic needed it
+static s64 run_tokenize_lazy_positions(String corpus)
+{
+    Lexer lexer;
+    lexer.initialize(corpus, true);
+    lexer.track_positions = false;
+
+    bench_tokens.count = 0;
+    lexer.tokenize(&bench_tokens);
+
+    int line, col;
+    lexer.resolve_position(bench_tokens.data[bench_tokens.count - 1].source_offset, &line, &col);
+    lexer.deinitialize();
+    return bench_tokens.count;
+}
+
+static b8 bench_scalar_numbers = false;
+
+static s64 run_tokenize_numbers(String corpus)
+{
+    Lexer lexer;
+    lexer.initialize(corpus, true);
+    lexer.scalar_numbers = bench_scalar_numbers;
+
+    bench_tokens.count = 0;
+    lexer.tokenize(&bench_tokens);
+    return bench_tokens.count;
+}
+
+static b8 bench_hand_written_operators = false;
+
+static s64 run_tokenize_operators(String corpus)
+{
+    Lexer lexer;
+    lexer.initialize(corpus, true);
+    lexer.hand_written_operators = bench_hand_written_operators;
+
+    bench_tokens.count = 0;
+    lexer.tokenize(&bench_tokens);
+    return bench_tokens.count;
+}
+
+static s64 run_tokenize_interned(String corpus)
+{
+    InternTable interner;
+    Lexer lexer;
+    lexer.initialize(corpus, true);
+    lexer.interner = &interner;
+
+    bench_tokens.count = 0;
+    lexer.tokenize(&bench_tokens);
+    interner.release();
+    return bench_tokens.count;
+}
+
+// the corpus arriving in 64K pieces, like reading from a pipe
+static s64 run_stream(String corpus)
+{
+    const u64 piece_size = 64 * 1024;
+
+    StreamLexer stream;
+    stream.initialize();
+    bench_tokens.count = 0;
+    bench_tokens.strings.reset();
+    for (u64 at = 0; at < corpus.length; at += piece_size)
+    {
+        u64 size = corpus.length - at;
+        if (size > piece_size) size = piece_size;
+        stream.feed(corpus.data + at, size, &bench_tokens);
+    }
+    stream.finish(&bench_tokens);
+    stream.release();
+    return bench_tokens.count;
+}
+
+static Diagnostics bench_diagnostics;
+
+static s64 run_tokenize_recover(String corpus)
+{
+    Lexer lexer;
+    lexer.initialize(corpus, true);
+    lexer.recover_errors = true;
+    lexer.diagnostics = &bench_diagnostics;
+
+    bench_diagnostics.count = 0;
+    bench_tokens.count = 0;
+    lexer.tokenize(&bench_tokens);
+    return bench_tokens.count;
+}
+
+static int bench_thread_count = 1;
+
+static s64 run_tokenize_parallel(String corpus)
+{
+    bench_tokens.count = 0;
+    tokenize_parallel(corpus, &bench_tokens, bench_thread_count, true);
+    return bench_tokens.count;
+}
+
+// a build that finds the file changed, lexes it and writes the cache
+static s64 run_cache_write(String corpus)
+{
+    bench_tokens.count = 0;
+    tokenize_all(corpus, &bench_tokens, true);
+    write_token_cache(BENCH_CACHE_PATH, corpus, &bench_tokens);
+    return bench_tokens.count;
+}
+
+// mapping the cache and checking the source hash, no token is decoded
+static s64 run_cache_open(String corpus)
+{
+    TokenCache cache;
+    if (!open_token_cache(BENCH_CACHE_PATH, corpus, &cache)) return 0;
+    s64 count = (s64)cache.token_count;
+    cache.release();
+    return count;
+}
+
+static s64 run_cache_hit(String corpus)
+{
+    TokenCache cache;
+    if (!open_token_cache(BENCH_CACHE_PATH, corpus, &cache)) return 0;
+    s64 count = 0;
+    Token token;
+    while (cache.next(&token)) count += 1;
+    cache.release();
+    return count;
+}
+
+static TokenStore bench_store;
+
+static s64 run_token_store(String corpus)
+{
+    bench_store.count = 0;
+    build_token_store(corpus, &bench_store, true);
+    return bench_store.count;
+}
+
+static void report_memory(String corpus)
+{
+    bench_tokens.count = 0;
+    bench_store.count = 0;
+    tokenize_all(corpus, &bench_tokens, true);
+    build_token_store(corpus, &bench_store, true);
+    bench_store.get_token(0); // builds the line table
+
+    f64 array_bytes = (f64)(bench_tokens.count * sizeof(Token));
+    f64 store_bytes = (f64)(bench_store.count * (sizeof(u16) + sizeof(u32) + sizeof(u32)) +
+                            bench_store.lines.count * sizeof(u32));
+    f64 count = (f64)bench_tokens.count;
+
+    fprintf(stdout, "TokenArray       %10.2f MB %8.2f bytes/token\n", array_bytes / (1024.0 * 1024.0), array_bytes / count);
+    fprintf(stdout, "TokenStore       %10.2f MB %8.2f bytes/token\n", store_bytes / (1024.0 * 1024.0), store_bytes / count);
+}
+
+// classification loop alone, the same questions the lexer asks per byte
+static void bench_classification(String corpus)
+{
+    f64 best_ctype = 1e30;
+    f64 best_table = 1e30;
+    s64 count_ctype = 0;
+    s64 count_table = 0;
+
+    for (int run = 0; run < BENCH_RUNS; ++run)
+    {
+        f64 start = get_wall_clock();
+        count_ctype = 0;
+        for (u64 i = 0; i < corpus.length; ++i)
+        {
+            int c = (u8)corpus.data[i];
+            if (isalnum(c) || (c == '_')) count_ctype += 1;
+            if (isspace(c)) count_ctype += 2;
+            if (isdigit(c)) count_ctype += 3;
+        }
+        f64 elapsed = get_wall_clock() - start;
+        if (elapsed < best_ctype) best_ctype = elapsed;
+
+        start = get_wall_clock();
+        count_table = 0;
+        for (u64 i = 0; i < corpus.length; ++i)
+        {
+            int c = (u8)corpus.data[i];
+            if (char_is(c, CharClass_IDENT_CONTINUE)) count_table += 1;
+            if (is_whitespace(c)) count_table += 2;
+            if (is_digit(c)) count_table += 3;
+        }
+        elapsed = get_wall_clock() - start;
+        if (elapsed < best_table) best_table = elapsed;
+    }
+
+    assert(count_ctype == count_table);
+    f64 megabytes = (f64)corpus.length / (1024.0 * 1024.0);
+    fprintf(stdout, "classify ctype   %10.2f MB/s\n", megabytes / best_ctype);
+    fprintf(stdout, "classify table   %10.2f MB/s\n", megabytes / best_table);
+}
+
+// xorshift, the same seed gives the same inputs on every machine
+static u64 random_state = 0x9e3779b97f4a7c15;
+
+static u64 random_next(void)
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+// lexes random number literals, good and broken, with and without the SWAR paths
+static int verify_numbers(s64 iterations)
+{
+    const char *alphabets[] = {"0123456789_.eE+-f", "0123456789abcdefABCDEF_g.", "0101010101_2.."};
+    const char *prefixes[] = {"", "0x", "0b"};
+    char text[64 + LEXER_INPUT_PADDING];
+    s64 mismatches = 0;
+
+    for (s64 i = 0; i < iterations; ++i)
+    {
+        int kind = (int)(random_next() % 3);
+        u64 length = strlen(prefixes[kind]);
+        memcpy(text, prefixes[kind], length);
+
+        const char *alphabet = alphabets[kind];
+        u64 alphabet_length = strlen(alphabet);
+        u64 digits = random_next() % 40;
+        for (u64 j = 0; j < digits; ++j) text[length++] = alphabet[random_next() % alphabet_length];
+        text[length++] = " \n;x"[random_next() % 4];
+        memset(text + length, 0, LEXER_INPUT_PADDING);
+
+        String input;
+        input.data = text;
+        input.length = length;
+
+        Lexer swar, scalar;
+        swar.initialize(input, true);
+        scalar.initialize(input, true);
+        scalar.scalar_numbers = true;
+
+        while (true)
+        {
+            Token *a = swar.generate_token();
+            Token *b = scalar.generate_token();
+            b8 same = (a->type == b->type) && (a->flags == b->flags) &&
+                (a->integer_value == b->integer_value) && (a->name.length == b->name.length) &&
+                (a->col_end == b->col_end) && (a->line_end == b->line_end) &&
+                (swar.error_count == scalar.error_count);
+            if (!same)
+            {
+                if (mismatches++ < 10) fprintf(stdout, "mismatch: '%.*s'\n", (int)length, text);
+                break;
+            }
+            if (a->type == TokenType_END_OF_FILE) break;
+        }
+    }
+
+    fprintf(stdout, "numbers: %lld inputs, %lld mismatches\n", iterations, mismatches);
+    return mismatches ? -1 : 0;
+}
+
+// lexes random runs of operator characters with the generated table and with the hand written switch
+static int verify_operators(s64 iterations)
+{
+    const char *alphabet = "=+-*/%!<>&|.^~?:;,(){}[]#$@=<>.&|-/*  \n\ta1\"";
+    u64 alphabet_length = strlen(alphabet);
+    char text[64 + LEXER_INPUT_PADDING];
+    s64 mismatches = 0;
+
+    for (s64 i = 0; i < iterations; ++i)
+    {
+        u64 length = random_next() % 64;
+        for (u64 j = 0; j < length; ++j) text[j] = alphabet[random_next() % alphabet_length];
+        memset(text + length, 0, LEXER_INPUT_PADDING);
+
+        String input;
+        input.data = text;
+        input.length = length;
+
+        Lexer dfa, hand;
+        dfa.initialize(input, true);
+        hand.initialize(input, true);
+        hand.hand_written_operators = true;
+
+        while (true)
+        {
+            Token *a = dfa.generate_token();
+            Token *b = hand.generate_token();
+            b8 same = (a->type == b->type) && (a->flags == b->flags) &&
+                (a->integer_value == b->integer_value) && (a->name.length == b->name.length) &&
+                (a->source_offset == b->source_offset) && (a->source_length == b->source_length) &&
+                (a->line_start == b->line_start) && (a->col_start == b->col_start) &&
+                (a->line_end == b->line_end) && (a->col_end == b->col_end) &&
+                (dfa.error_count == hand.error_count);
+            if (!same)
+            {
+                if (mismatches++ < 10) fprintf(stdout, "mismatch: '%.*s'\n", (int)length, text);
+                break;
+            }
+            if (a->type == TokenType_END_OF_FILE) break;
+        }
+        dfa.deinitialize();
+        hand.deinitialize();
+    }
+
+    fprintf(stdout, "operators: %lld inputs, %lld mismatches\n", iterations, mismatches);
+    return mismatches ? -1 : 0;
+}
+
+// feeds generated source and the error snippet to a StreamLexer in random pieces, down to
+// single bytes, and checks the tokens, names included, against the ones tokenize_all produces
+static int verify_stream(s64 iterations)
+{
+    s64 rounds = (iterations / 20000) ? (iterations / 20000) : 1;
+    s64 mismatches = 0;
+    for (s64 round = 0; (round < rounds) && (mismatches < 10); ++round)
+    {
+        String source;
+        if (round % 4 == 3) source = make_corpus(error_snippet, 4 * 1024);
+        else source = generate_corpus((CorpusProfile)(round % CorpusProfile_COUNT), 16 * 1024, (u64)round);
+
+        TokenArray expected;
+        Diagnostics expected_errors;
+        tokenize_all(source, &expected, true, &expected_errors);
+
+        TokenArray tokens;
+        Diagnostics errors;
+        StreamLexer stream;
+        stream.initialize(0, &errors);
+        for (u64 at = 0; at < source.length;)
+        {
+            // mostly small pieces, every token is cut somewhere
+            u64 size = (random_next() % 4) ? 1 + random_next() % 8 : 1 + random_next() % 256;
+            if (size > source.length - at) size = source.length - at;
+            stream.feed(source.data + at, size, &tokens);
+            at += size;
+        }
+        stream.finish(&tokens);
+        // the names have to outlive the stream's buffer
+        stream.release();
+
+        b8 same = (tokens.count == expected.count) && (errors.count == expected_errors.count);
+        for (s64 i = 0; same && (i < tokens.count); ++i)
+        {
+            Token *a = &tokens.data[i];
+            Token *b = &expected.data[i];
+            same = (a->type == b->type) && (a->flags == b->flags) && (a->integer_value == b->integer_value) &&
+                (a->source_offset == b->source_offset) && (a->source_length == b->source_length) &&
+                (a->line_start == b->line_start) && (a->col_start == b->col_start) &&
+                (a->line_end == b->line_end) && (a->col_end == b->col_end) &&
+                (a->name.length == b->name.length) &&
+                (!a->name.length || (memcmp(a->name.data, b->name.data, a->name.length) == 0));
+            if (!same) fprintf(stdout, "mismatch: round %lld, token %lld\n", round, i);
+        }
+        if (!same)
+        {
+            if (tokens.count != expected.count) fprintf(stdout, "mismatch: round %lld, %lld tokens instead of %lld\n", round, tokens.count, expected.count);
+            mismatches += 1;
+        }
+
+        tokens.release();
+        expected.release();
+        errors.release();
+        expected_errors.release();
+        free(source.data);
+    }
+
+    fprintf(stdout, "stream: %lld sources, %lld mismatches\n", rounds, mismatches);
+    return mismatches ? -1 : 0;
+}
+
+static u64 arena_used(Arena *arena)
+{
+    u64 result = 0;
+    for (ArenaBlock *block = arena->first; block; block = block->next) result += block->used;
+    return result;
+}
+
+// types into generated source, a lot of it in front of escaped string literals, and checks
+// after every relex_edit that the tokens are the ones tokenize_all gives and that the string
+// arena holds no more than the payloads in use plus the ones counted as unused
+static int verify_incremental(s64 iterations)
+{
+    s64 rounds = (iterations / 100000) ? (iterations / 100000) : 1;
+    s64 edits_per_round = 1000;
+    u64 max_growth = 4 * 1024;
+    s64 mismatches = 0;
+    for (s64 round = 0; (round < rounds) && (mismatches < 10); ++round)
+    {
+        String generated = generate_corpus((round & 1) ? CorpusProfile_MIXED : CorpusProfile_STRINGS, 16 * 1024, (u64)round);
+        String text;
+        text.data = (char*)calloc(1, generated.length + max_growth + LEXER_INPUT_PADDING);
+        text.length = generated.length;
+        memcpy(text.data, generated.data, generated.length);
+        free(generated.data);
+
+        TokenArray tokens;
+        tokenize_all(text, &tokens, true);
+
+        for (s64 i = 0; (i < edits_per_round) && (mismatches < 10); ++i)
+        {
+            TextEdit edit;
+            edit.offset = random_next() % text.length;
+            String before = text;
+            if ((random_next() % 3) && (text.length < generated.length + max_growth))
+            {
+                // mostly spaces in front of the next literal, the token relex_edit syncs on
+                if (random_next() & 1)
+                {
+                    const char *quote = (const char*)memchr(text.data + edit.offset, '"', text.length - edit.offset);
+                    if (quote) edit.offset = quote - text.data;
+                }
+                static const char typed[] = " a1\n+(";
+                memmove(text.data + edit.offset + 1, text.data + edit.offset, text.length - edit.offset);
+                text.data[edit.offset] = typed[random_next() % (sizeof(typed) - 1)];
+                text.length += 1;
+                edit.inserted_length = 1;
+            }
+            else
+            {
+                memmove(text.data + edit.offset, text.data + edit.offset + 1, text.length - edit.offset - 1);
+                text.length -= 1;
+                text.data[text.length] = 0;
+                edit.deleted_length = 1;
+            }
+            relex_edit(&tokens, before, text, edit);
+
+            TokenArray expected;
+            tokenize_all(text, &expected, true);
+
+            b8 same = tokens.count == expected.count;
+            u64 payload_bytes = 0;
+            for (s64 j = 0; same && (j < tokens.count); ++j)
+            {
+                Token *a = &tokens.data[j];
+                Token *b = &expected.data[j];
+                same = (a->type == b->type) && (a->flags == b->flags) && (a->integer_value == b->integer_value) &&
+                    (a->source_offset == b->source_offset) && (a->source_length == b->source_length) &&
+                    (a->line_start == b->line_start) && (a->col_start == b->col_start) &&
+                    (a->line_end == b->line_end) && (a->col_end == b->col_end) &&
+                    (a->name.length == b->name.length) &&
+                    (!a->name.length || (memcmp(a->name.data, b->name.data, a->name.length) == 0));
+                if (a->name.data && ((a->name.data < text.data) || (a->name.data > text.data + text.length)))
+                {
+                    payload_bytes += (a->name.length + 1 + 7) & ~7ull;
+                }
+            }
+            if (!same)
+            {
+                fprintf(stdout, "mismatch: round %lld, edit %lld at %llu\n", round, i, edit.offset);
+                mismatches += 1;
+            }
+            else if (arena_used(&tokens.strings) > payload_bytes + tokens.unused_string_bytes)
+            {
+                fprintf(stdout, "mismatch: round %lld, edit %lld, %llu bytes in the string arena, %llu used and %llu unused\n",
+                        round, i, arena_used(&tokens.strings), payload_bytes, tokens.unused_string_bytes);
+                mismatches += 1;
+            }
+            expected.release();
+        }
+
+        tokens.release();
+        free(text.data);
+    }
+
+    fprintf(stdout, "incremental: %lld edits, %lld mismatches\n", rounds * edits_per_round, mismatches);
+    return mismatches ? -1 : 0;
+}
+
+// walks generated source with random peeks, marks and rewinds and checks every token
+// against the ones tokenize_all produces
+static int verify_lookahead(s64 iterations)
+{
+    const int depth = 16;
+    String corpus = generate_corpus(CorpusProfile_MIXED, 256 * 1024, 1);
+    TokenArray expected;
+    tokenize_all(corpus, &expected, true);
+
+    LookaheadLexer<depth> lexer;
+    lexer.initialize(corpus, true);
+
+    TokenMark marks[4];
+    int mark_count = 0;
+    s64 position = 0; // in expected
+    s64 mismatches = 0;
+    for (s64 i = 0; (i < iterations) && !mismatches; ++i)
+    {
+        // the tokens the marks keep take room from the lookahead
+        int kept = mark_count ? (int)(position - (s64)marks[0]) : 0;
+        switch (random_next() % 8)
+        {
+            case 0:
+            {
+                if ((mark_count < 4) && (kept < depth / 2)) marks[mark_count++] = lexer.mark();
+            } break;
+
+            case 1:
+            {
+                if (!mark_count) break;
+                mark_count -= 1;
+                if (random_next() % 2)
+                {
+                    lexer.rewind(marks[mark_count]);
+                    position = (s64)marks[mark_count];
+                }
+                else
+                {
+                    lexer.drop_mark(marks[mark_count]);
+                }
+            } break;
+
+            case 2:
+            case 3:
+            {
+                s64 index = (s64)(random_next() % (u64)(depth - kept));
+                if (position + index >= expected.count) break;
+
+                Token *a = lexer.peek((int)index);
+                Token *b = &expected.data[position + index];
+                b8 same = (a->type == b->type) && (a->flags == b->flags) &&
+                    (a->integer_value == b->integer_value) && (a->name.length == b->name.length) &&
+                    (!a->name.length || (memcmp(a->name.data, b->name.data, a->name.length) == 0)) &&
+                    (a->source_offset == b->source_offset) && (a->line_start == b->line_start) &&
+                    (a->col_start == b->col_start);
+                if (!same)
+                {
+                    fprintf(stdout, "mismatch: token %lld\n", position + index);
+                    mismatches += 1;
+                }
+            } break;
+
+            default:
+            {
+                // a mark holds at most depth / 2 tokens, the rest is for peeks
+                if ((kept < depth / 2) && (position + 1 < expected.count))
+                {
+                    lexer.peek(); // only a token that was looked at can be eaten
+                    lexer.eat();
+                    position += 1;
+                }
+                else if (mark_count)
+                {
+                    mark_count -= 1;
+                    lexer.drop_mark(marks[mark_count]);
+                }
+                else
+                {
+                    // at the end, start over
+                    lexer.initialize(corpus, true);
+                    position = 0;
+                }
+            } break;
+        }
+    }
+
+    fprintf(stdout, "lookahead: %lld steps, %lld mismatches\n", iterations, mismatches);
+    lexer.deinitialize();
+    expected.release();
+    free(corpus.data);
+    return mismatches ? -1 : 0;
+}
+
+// typing into a 50k line file: insert a character, then take it back out again.
+// the text is edited in place, only relex_edit is timed
+static void bench_incremental(void)
+{
+    u64 snippet_lines = 0;
+    for (const char *at = corpus_snippet; *at; ++at) snippet_lines += (*at == '\n');
+    u64 snippet_length = strlen(corpus_snippet);
+    u64 wanted_lines = 50000;
+
+    String text = make_corpus(corpus_snippet, (wanted_lines / snippet_lines) * snippet_length);
+    text.data = (char*)realloc(text.data, text.length + 1 + LEXER_INPUT_PADDING);
+    memset(text.data + text.length, 0, 1 + LEXER_INPUT_PADDING);
+
+    TokenArray tokens;
+    tokenize_all(text, &tokens, true);
+
+    const int edit_count = 2000;
+    f64 seconds = 0;
+    for (int i = 0; i < edit_count; ++i)
+    {
+        TextEdit edit;
+        edit.offset = random_next() % text.length;
+
+        String before = text;
+        memmove(text.data + edit.offset + 1, text.data + edit.offset, text.length - edit.offset);
+        text.data[edit.offset] = 'x';
+        text.length += 1;
+        edit.inserted_length = 1;
+
+        f64 start = get_wall_clock();
+        relex_edit(&tokens, before, text, edit);
+        seconds += get_wall_clock() - start;
+
+        before = text;
+        memmove(text.data + edit.offset, text.data + edit.offset + 1, text.length - edit.offset - 1);
+        text.length -= 1;
+        text.data[text.length] = 0;
+        edit.inserted_length = 0;
+        edit.deleted_length = 1;
+
+        start = get_wall_clock();
+        relex_edit(&tokens, before, text, edit);
+        seconds += get_wall_clock() - start;
+    }
+
+    fprintf(stdout, "\nincremental: %llu lines, %lld tokens, %.2f us per edit\n",
+            (text.length / snippet_length) * snippet_lines, tokens.count, seconds * 1e6 / (2 * edit_count));
+    tokens.release();
+    free(text.data);
+}
+
+/////////////////////////////////////////////////////////
+// suite: every generated profile, results written as json and checked against a baseline
+struct SuiteResult
+{
+    const char *profile = null;
+    u64 bytes = 0;
+    s64 tokens = 0;
+    f64 seconds = 0;   // of one pass over the input
+    f64 cycles = 0;    // of one pass over the input
+    u64 peak_memory = 0;
+};
+
+struct SuiteOptions
+{
+    u64 size = 16 * 1024 * 1024;
+    u64 seed = 1;
+    const char *profile = null; // only this one when set
+    const char *output_path = "bench_results.json";
+    const char *baseline_path = null;
+    f64 tolerance = 10.0; // percent of MB/s a profile may lose against the baseline
+};
+
+// 64K, 16M, 1G or a plain byte count
+static u64 parse_size(const char *text)
+{
+    char *end;
+    u64 result = strtoull(text, &end, 10);
+    switch (*end)
+    {
+        case 'k': case 'K': result *= 1024ull; break;
+        case 'm': case 'M': result *= 1024ull * 1024; break;
+        case 'g': case 'G': result *= 1024ull * 1024 * 1024; break;
+    }
+    return result;
+}
+
+// the lexer alone, tokens go through the ring so memory does not grow with the input
+static s64 lex_once(String corpus)
+{
+    Lexer lexer;
+    lexer.initialize(corpus, true);
+
+    s64 count = 0;
+    while (true)
+    {
+        Token *token = lexer.generate_token();
+        count += 1;
+        if (token->type == TokenType_END_OF_FILE) break;
+    }
+    lexer.deinitialize();
+    return count;
+}
+
+static SuiteResult run_suite_profile(CorpusProfile profile, SuiteOptions *options)
+{
+    SuiteResult result;
+    result.profile = corpus_profile_name(profile);
+
+    reset_peak_memory();
+    String corpus = generate_corpus(profile, options->size, options->seed);
+    result.bytes = corpus.length;
+
+    s64 passes = 1;
+    if (corpus.length && (corpus.length < SUITE_MIN_SAMPLE_BYTES)) passes = (s64)(SUITE_MIN_SAMPLE_BYTES / corpus.length);
+
+    result.seconds = 1e30;
+    result.cycles = 1e30;
+    for (int run = 0; run < BENCH_RUNS; ++run)
+    {
+        f64 start = get_wall_clock();
+        u64 start_cycles = get_cycle_count();
+        for (s64 pass = 0; pass < passes; ++pass) result.tokens = lex_once(corpus);
+        f64 cycles = (f64)(get_cycle_count() - start_cycles) / (f64)passes;
+        f64 seconds = (get_wall_clock() - start) / (f64)passes;
+
+        if (seconds < result.seconds) result.seconds = seconds;
+        if (cycles < result.cycles) result.cycles = cycles;
+    }
+
+    result.peak_memory = get_peak_memory();
+    free(corpus.data);
+    return result;
+}
+
+static f64 megabytes_per_second(SuiteResult *result)
+{
+    return (f64)result->bytes / (1024.0 * 1024.0) / result->seconds;
+}
+
+// one result per line, so the baseline can be read back a line at a time
+static b8 write_suite_results(const char *path, SuiteOptions *options, SuiteResult *results, int count)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file) return false;
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"seed\": %llu,\n", options->seed);
+    fprintf(file, "  \"size\": %llu,\n", options->size);
+    fprintf(file, "  \"scan_kernels\": \"%s\",\n", scan.name);
+    fprintf(file, "  \"results\": [\n");
+    for (int i = 0; i < count; ++i)
+    {
+        SuiteResult *result = &results[i];
+        fprintf(file, "    {\"profile\": \"%s\", \"bytes\": %llu, \"tokens\": %lld, \"mb_per_s\": %.2f, "
+                      "\"tokens_per_s\": %.0f, \"cycles_per_token\": %.3f, \"peak_rss_bytes\": %llu}%s\n",
+                result->profile, result->bytes, result->tokens, megabytes_per_second(result),
+                (f64)result->tokens / result->seconds, result->cycles / (f64)result->tokens,
+                result->peak_memory, (i + 1 < count) ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    return fclose(file) == 0;
+}
+
+// reads back what write_suite_results wrote, returns -1 when the baseline can't be used
+static int compare_with_baseline(SuiteOptions *options, SuiteResult *results, int count)
+{
+    MappedFile file;
+    if (!map_file(options->baseline_path, &file, 1, (u64)-1))
+    {
+        fprintf(stdout, "could not open baseline %s\n", options->baseline_path);
+        return -1;
+    }
+
+    unsigned long long seed = 0;
+    unsigned long long size = 0;
+    const char *at = strstr(file.contents.data, "\"seed\":");
+    if (at) sscanf(at, "\"seed\": %llu", &seed);
+    at = strstr(file.contents.data, "\"size\":");
+    if (at) sscanf(at, "\"size\": %llu", &size);
+    if ((seed != options->seed) || (size != options->size))
+    {
+        fprintf(stdout, "baseline %s was made with seed %llu and size %llu, it can't be compared\n",
+                options->baseline_path, seed, size);
+        unmap_file(&file);
+        return -1;
+    }
+
+    fprintf(stdout, "\n%-12s %12s %12s %9s\n", "profile", "baseline", "now", "change");
+    int regressions = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        SuiteResult *result = &results[i];
+        char key[64];
+        snprintf(key, sizeof(key), "{\"profile\": \"%s\"", result->profile);
+        at = strstr(file.contents.data, key);
+        const char *speed = at ? strstr(at, "\"mb_per_s\":") : null;
+        f64 before = 0;
+        if (!speed || (sscanf(speed, "\"mb_per_s\": %lf", &before) != 1) || (before <= 0))
+        {
+            fprintf(stdout, "%-12s %12s %9.2f MB/s\n", result->profile, "-", megabytes_per_second(result));
+            continue;
+        }
+
+        f64 now = megabytes_per_second(result);
+        f64 change = (now - before) / before * 100.0;
+        b8 regressed = change < -options->tolerance;
+        if (regressed) regressions += 1;
+        fprintf(stdout, "%-12s %7.2f MB/s %7.2f MB/s %+8.1f%%%s\n",
+                result->profile, before, now, change, regressed ? "  REGRESSION" : "");
+    }
+
+    unmap_file(&file);
+    return regressions;
+}
+
+// all profiles run when none was asked for
+static b8 is_known_profile(const char *name)
+{
+    if (!name) return true;
+    for (int i = 0; i < CorpusProfile_COUNT; ++i)
+    {
+        if (strcmp(name, corpus_profile_name((CorpusProfile)i)) == 0) return true;
+    }
+    return false;
+}
+
+static int run_suite(SuiteOptions *options)
+{
+    if (!is_known_profile(options->profile))
+    {
+        fprintf(stdout, "unknown profile %s\n", options->profile);
+        return 1;
+    }
+
+    fprintf(stdout, "scan kernels: %s, seed %llu, %llu bytes per profile\n\n", scan.name, options->seed, options->size);
+    fprintf(stdout, "%-12s %12s %16s %14s %12s\n", "profile", "MB/s", "tokens/s", "cycles/token", "peak RSS");
+
+    SuiteResult results[CorpusProfile_COUNT];
+    int count = 0;
+    for (int i = 0; i < CorpusProfile_COUNT; ++i)
+    {
+        CorpusProfile profile = (CorpusProfile)i;
+        if (options->profile && (strcmp(options->profile, corpus_profile_name(profile)) != 0)) continue;
+
+        SuiteResult *result = &results[count++];
+        *result = run_suite_profile(profile, options);
+        fprintf(stdout, "%-12s %12.2f %16.0f %14.3f %9.1f MB\n",
+                result->profile, megabytes_per_second(result), (f64)result->tokens / result->seconds,
+                result->cycles / (f64)result->tokens, (f64)result->peak_memory / (1024.0 * 1024.0));
+    }
+
+    if (!write_suite_results(options->output_path, options, results, count))
+    {
+        fprintf(stdout, "could not write %s\n", options->output_path);
+        return 1;
+    }
+    fprintf(stdout, "\nresults written to %s\n", options->output_path);
+
+    if (!options->baseline_path) return 0;
+    int regressions = compare_with_baseline(options, results, count);
+    if (regressions < 0) return 1;
+    if (regressions)
+    {
+        fprintf(stdout, "%d profile(s) lost more than %.1f%% against the baseline\n", regressions, options->tolerance);
+        return 1;
+    }
+    return 0;
+}
+
+// lexes every profile once and prints the counters of an instrumented build
+static int run_stats(SuiteOptions *options)
+{
+    if (!is_known_profile(options->profile))
+    {
+        fprintf(stdout, "unknown profile %s\n", options->profile);
+        return 1;
+    }
+
+    for (int i = 0; i < CorpusProfile_COUNT; ++i)
+    {
+        CorpusProfile profile = (CorpusProfile)i;
+        if (options->profile && (strcmp(options->profile, corpus_profile_name(profile)) != 0)) continue;
+
+        String corpus = generate_corpus(profile, options->size, options->seed);
+        reset_lexer_stats();
+        lex_once(corpus);
+        fprintf(stdout, "%s, %llu bytes\n", corpus_profile_name(profile), corpus.length);
+        report_lexer_stats(stdout);
+        fprintf(stdout, "\n");
+        free(corpus.data);
+    }
+    return 0;
+}
+
+static void bench(const char *name, String corpus, s64 (*proc)(String))
+{
+    f64 best = 1e30;
+    s64 count = 0;
+    for (int run = 0; run < BENCH_RUNS; ++run)
+    {
+        f64 start = get_wall_clock();
+        count = proc(corpus);
+        f64 elapsed = get_wall_clock() - start;
+        if (elapsed < best) best = elapsed;
+    }
+    report(name, corpus, count, best);
+}
+
+int main(int argc, char **argv)
+{
+    // lexer_bench verify [iterations]
+    if ((argc > 1) && (strcmp(argv[1], "verify") == 0))
+    {
+        s64 iterations = 1000000;
+        if (argc > 2) iterations = strtoll(argv[2], null, 10);
+        int result = verify_numbers(iterations);
+        if (verify_operators(iterations)) result = -1;
+        if (verify_lookahead(iterations)) result = -1;
+        if (verify_stream(iterations)) result = -1;
+        if (verify_incremental(iterations)) result = -1;
+        return result;
+    }
+
+    // lexer_bench suite [size] [--seed n] [--profile name] [--out path] [--baseline path] [--tolerance percent]
+    // lexer_bench stats [size] [--seed n] [--profile name], for builds with LEXER_INSTRUMENT
+    if ((argc > 1) && ((strcmp(argv[1], "suite") == 0) || (strcmp(argv[1], "stats") == 0)))
+    {
+        SuiteOptions options;
+        for (int i = 2; i < argc; ++i)
+        {
+            b8 has_value = i + 1 < argc;
+            if (has_value && (strcmp(argv[i], "--seed") == 0)) options.seed = strtoull(argv[++i], null, 10);
+            else if (has_value && (strcmp(argv[i], "--profile") == 0)) options.profile = argv[++i];
+            else if (has_value && (strcmp(argv[i], "--out") == 0)) options.output_path = argv[++i];
+            else if (has_value && (strcmp(argv[i], "--baseline") == 0)) options.baseline_path = argv[++i];
+            else if (has_value && (strcmp(argv[i], "--tolerance") == 0)) options.tolerance = atof(argv[++i]);
+            else options.size = parse_size(argv[i]);
+        }
+        if (strcmp(argv[1], "stats") == 0) return run_stats(&options);
+        return run_suite(&options);
+    }
+
+    // lexer_bench [megabytes] [max threads]
+    u64 megabytes = 16;
+    if (argc > 1) megabytes = strtoull(argv[1], null, 10);
+    int max_threads = get_processor_count();
+    if (argc > 2) max_threads = atoi(argv[2]);
+
+    fprintf(stdout, "scan kernels: %s\n", scan.name);
+
+    String corpus = make_corpus(corpus_snippet, megabytes * 1024 * 1024);
+    fprintf(stdout, "corpus: %llu bytes\n", corpus.length);
+
+    bench("pull loop", corpus, run_pull_loop);
+    bench("lookahead x16", corpus, run_lookahead);
+    bench("tokenize_all", corpus, run_tokenize_all);
+    bench("lazy positions", corpus, run_tokenize_lazy_positions);
+    bench("token store", corpus, run_token_store);
+    bench("stream 64K", corpus, run_stream);
+    bench("lex + cache write", corpus, run_cache_write);
+    bench("cache open", corpus, run_cache_open);
+    bench("cache hit", corpus, run_cache_hit);
+    remove(BENCH_CACHE_PATH);
+
+    for (bench_thread_count = 1; bench_thread_count <= max_threads; bench_thread_count *= 2)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "parallel x%d", bench_thread_count);
+        bench(name, corpus, run_tokenize_parallel);
+    }
+
+    report_memory(corpus);
+    bench_classification(corpus);
+
+    bench("recover clean", corpus, run_tokenize_recover);
+    String errors = make_corpus(error_snippet, megabytes * 1024 * 1024);
+    bench("recover errors", errors, run_tokenize_recover);
+    fprintf(stdout, "recovered from %lld errors\n", bench_diagnostics.count);
+    free(errors.data);
+    bench_diagnostics.release();
+
+    String comments = make_corpus(comment_snippet, megabytes * 1024 * 1024);
+    fprintf(stdout, "\nwhitespace and comments corpus: %llu bytes\n", comments.length);
+    bench("tokenize_all", comments, run_tokenize_all);
+    free(comments.data);
+
+    String identifiers = make_corpus(identifier_snippet, megabytes * 1024 * 1024);
+    fprintf(stdout, "\nidentifier corpus: %llu bytes\n", identifiers.length);
+    bench("tokenize_all", identifiers, run_tokenize_all);
+    bench("interned", identifiers, run_tokenize_interned);
+    free(identifiers.data);
+
+    String numbers = make_corpus(number_snippet, megabytes * 1024 * 1024);
+    fprintf(stdout, "\nnumber corpus: %llu bytes\n", numbers.length);
+    bench_scalar_numbers = true;
+    bench("numbers scalar", numbers, run_tokenize_numbers);
+    bench_scalar_numbers = false;
+    bench("numbers swar", numbers, run_tokenize_numbers);
+    free(numbers.data);
+
+    // generated, a repeated snippet would let the hand written branches predict perfectly
+    String expressions = generate_corpus(CorpusProfile_EXPRESSIONS, megabytes * 1024 * 1024, 1);
+    fprintf(stdout, "\nexpression corpus: %llu bytes\n", expressions.length);
+    bench_hand_written_operators = true;
+    bench("operators by hand", expressions, run_tokenize_operators);
+    bench_hand_written_operators = false;
+    bench("operators table", expressions, run_tokenize_operators);
+    free(expressions.data);
+
+    bench_incremental();
+
+    bench_tokens.release();
+    bench_store.release();
+    free(corpus.data);
+    return 0;
+}
\ No newline at end of file
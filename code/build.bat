@@ -1,7 +1,9 @@
 @echo off
 
 set CompilerFlags=-g -Wall -Werror -Wextra
+set LexerFiles=..\code\lexer.cpp ..\code\arena.cpp ..\code\platform.cpp ..\code\scan.cpp ..\code\parallel.cpp ..\code\driver.cpp ..\code\intern.cpp ..\code\incremental.cpp ..\code\stream.cpp ..\code\diagnostics.cpp ..\code\cache.cpp ..\code\instrument.cpp
 
 pushd ..\build
-gcc %CompilerFlags% ..\code\main.cpp ..\code\lexer.cpp -o lexer.exe 
+gcc %CompilerFlags% ..\code\main.cpp %LexerFiles% -o lexer.exe 
+gcc %CompilerFlags% -O2 ..\code\bench.cpp ..\code\corpus.cpp %LexerFiles% -o lexer_bench.exe 
 popd
\ No newline at end of file
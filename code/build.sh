@@ -0,0 +1,21 @@
+#!/bin/sh
+set -e
+
+CompilerFlags="-g -Wall -Werror -Wextra"
+LexerFiles="../code/lexer.cpp ../code/arena.cpp ../code/platform.cpp ../code/scan.cpp ../code/parallel.cpp ../code/driver.cpp ../code/intern.cpp ../code/incremental.cpp ../code/stream.cpp ../code/diagnostics.cpp ../code/cache.cpp ../code/instrument.cpp"
+
+cd "$(dirname "$0")"
+mkdir -p ../build
+cd ../build
+g++ $CompilerFlags ../code/main.cpp $LexerFiles -o lexer -lpthread
+g++ $CompilerFlags -O2 ../code/bench.cpp ../code/corpus.cpp $LexerFiles -o lexer_bench -lpthread
+
+# ./build.sh bench [suite arguments]: runs the suite, checked against ../build/bench_baseline.json when there is one
+if [ "$1" = "bench" ]; then
+    shift
+    if [ -f bench_baseline.json ]; then
+        ./lexer_bench suite "$@" --baseline bench_baseline.json
+    else
+        ./lexer_bench suite "$@"
+    fi
+fi
@@ -0,0 +1,377 @@
+#include "cache.h"
+#include "intern.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// shape of a token, the flags of the token are stored above these bits
+#define CACHE_TOKEN_MOVED_END   0x1 // line_end and col_end follow, they are not on the same line right after the text
+#define CACHE_TOKEN_SOURCE_NAME 0x2 // the name is a slice of the source, its start within the token and length follow
+#define CACHE_TOKEN_SHAPE_BITS  2
+
+// zero bytes between the stream and the string table, so tokens are decoded without bounds checks
+#define CACHE_STREAM_PADDING 128
+
+/////////////////////////////////////////////////////////
+u64 hash_source(String source)
+{
+    // four independent lanes so the multiplies overlap, 32 bytes per step
+    const u64 prime = 0x9E3779B185EBCA87ull;
+    u64 lanes[4] = { 0x243F6A8885A308D3ull, 0x13198A2E03707344ull, 0xA4093822299F31D0ull, 0x082EFA98EC4E6C89ull };
+
+    const char *at = source.data;
+    u64 left = source.length;
+    while (left >= 32)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            u64 word;
+            memcpy(&word, at + i * 8, 8);
+            lanes[i] = (lanes[i] ^ word) * prime;
+            lanes[i] ^= lanes[i] >> 29;
+        }
+        at += 32;
+        left -= 32;
+    }
+
+    u64 result = source.length;
+    for (int i = 0; i < 4; ++i) result = (result ^ lanes[i]) * prime;
+    while (left)
+    {
+        u64 word = 0;
+        u64 size = (left < 8) ? left : 8;
+        memcpy(&word, at, size);
+        result = (result ^ word) * prime;
+        result ^= result >> 29;
+        at += size;
+        left -= size;
+    }
+    result ^= result >> 32;
+    return result;
+}
+
+/////////////////////////////////////////////////////////
+// writing
+struct CacheBuffer
+{
+    u8 *data = null;
+    u64 size = 0;
+    u64 allocated = 0;
+
+    void reserve(u64 wanted)
+    {
+        if (wanted <= allocated) return;
+        u64 new_allocated = allocated ? allocated * 2 : 4096;
+        while (new_allocated < wanted) new_allocated *= 2;
+        data = (u8*)realloc(data, new_allocated);
+        allocated = new_allocated;
+    }
+
+    void put_bytes(const void *bytes, u64 count)
+    {
+        reserve(size + count);
+        memcpy(data + size, bytes, count);
+        size += count;
+    }
+
+    void put_varint(u64 value)
+    {
+        reserve(size + 10);
+        while (value >= 0x80)
+        {
+            data[size++] = (u8)(value | 0x80);
+            value >>= 7;
+        }
+        data[size++] = (u8)value;
+    }
+
+    // small negative numbers stay small
+    void put_signed_varint(s64 value)
+    {
+        put_varint(((u64)value << 1) ^ (u64)(value >> 63));
+    }
+};
+
+static b8 has_table_name(TokenType type)
+{
+    return (type == TokenType_IDENTIFIER) || (type == TokenType_STRING);
+}
+
+b8 write_token_cache(const char *path, String source, TokenArray *tokens)
+{
+    if (source.length > 0xFFFFFFFF) return false;
+
+    CacheBuffer stream;
+    stream.reserve((u64)tokens->count * 6);
+
+    InternTable names;
+    u32 offset = 0;
+    int line = 1;
+    for (s64 i = 0; i < tokens->count; ++i)
+    {
+        Token *token = &tokens->data[i];
+
+        u32 shape = (u32)token->flags << CACHE_TOKEN_SHAPE_BITS;
+        b8 moved_end = (token->line_end != token->line_start) ||
+                       (token->col_end != token->col_start + (int)token->source_length);
+        if (moved_end) shape |= CACHE_TOKEN_MOVED_END;
+
+        // numbers leave their prefix out of the name, punctuation has none
+        const char *token_text = source.data + token->source_offset;
+        b8 source_name = !has_table_name(token->type) && token->name.data;
+        assert(!source_name || ((token->name.data >= token_text) &&
+                                (token->name.data + token->name.length <= token_text + token->source_length)));
+        if (source_name) shape |= CACHE_TOKEN_SOURCE_NAME;
+
+        stream.put_varint((u64)token->type);
+        stream.put_signed_varint((s64)token->source_offset - (s64)offset);
+        stream.put_varint(token->source_length);
+        stream.put_signed_varint(token->line_start - line);
+        stream.put_varint((u64)token->col_start);
+        stream.put_varint(shape);
+        if (moved_end)
+        {
+            stream.put_signed_varint(token->line_end - token->line_start);
+            stream.put_varint((u64)token->col_end);
+        }
+        if (source_name)
+        {
+            stream.put_varint((u64)(token->name.data - token_text));
+            stream.put_varint(token->name.length);
+        }
+
+        if (token->type == TokenType_NUMBER)
+        {
+            // floats keep their exact bits
+            if (token->flags & LiteralNumber_FLOAT) stream.put_bytes(&token->float_value, sizeof(f64));
+            else stream.put_varint(token->integer_value);
+        }
+        else if (has_table_name(token->type))
+        {
+            // empty string literals have no data
+            const char *name = token->name.length ? token->name.data : "";
+            u32 hash = INTERN_HASH_SEED;
+            for (u64 c = 0; c < token->name.length; ++c) hash = intern_hash_step(hash, (u8)name[c]);
+            stream.put_varint(names.intern(name, token->name.length, hash));
+        }
+
+        offset = token->source_offset;
+        line = token->line_start;
+    }
+
+    // every string is followed by a 0, like decoded string literals are
+    u32 *ends = (u32*)malloc(((u64)names.count + 1) * sizeof(u32));
+    u32 end = 0;
+    for (u32 i = 0; i < names.count; ++i)
+    {
+        end += (u32)names.names[i].length;
+        ends[i] = end;
+        end += 1;
+    }
+
+    TokenCacheHeader header;
+    header.magic = TOKEN_CACHE_MAGIC;
+    header.version = TOKEN_CACHE_VERSION;
+    header.source_hash = hash_source(source);
+    header.source_length = source.length;
+    header.token_count = (u64)tokens->count;
+    header.stream_offset = sizeof(TokenCacheHeader);
+    header.stream_size = stream.size;
+    header.string_count = names.count;
+    header.strings_offset = (header.stream_offset + header.stream_size + CACHE_STREAM_PADDING + 3) & ~3ull;
+
+    b8 result = false;
+    FILE *file = fopen(path, "wb");
+    if (file)
+    {
+        const u8 zeros[CACHE_STREAM_PADDING + 4] = {};
+        u64 padding = header.strings_offset - header.stream_offset - header.stream_size;
+        result = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+                 (fwrite(stream.data, 1, stream.size, file) == stream.size) &&
+                 (fwrite(zeros, 1, padding, file) == padding) &&
+                 (fwrite(ends, sizeof(u32), names.count, file) == names.count);
+        for (u32 i = 0; result && (i < names.count); ++i)
+        {
+            String name = names.names[i];
+            result = (fwrite(name.data, 1, name.length, file) == name.length) && (fwrite(zeros, 1, 1, file) == 1);
+        }
+        if (fclose(file) != 0) result = false;
+        if (!result) remove(path);
+    }
+
+    free(ends);
+    free(stream.data);
+    names.release();
+    return result;
+}
+
+/////////////////////////////////////////////////////////
+// reading
+b8 open_token_cache(const char *path, String source, TokenCache *out)
+{
+    *out = TokenCache();
+    if (!map_file(path, &out->file, 0, (u64)-1)) return false;
+
+    String contents = out->file.contents;
+    TokenCacheHeader header;
+    b8 valid = contents.length >= sizeof(header);
+    if (valid)
+    {
+        memcpy(&header, contents.data, sizeof(header));
+        valid = (header.magic == TOKEN_CACHE_MAGIC) &&
+                (header.version == TOKEN_CACHE_VERSION) &&
+                (header.source_length == source.length) &&
+                (header.stream_offset <= contents.length) &&
+                (header.stream_size <= contents.length - header.stream_offset) &&
+                ((header.strings_offset & 3) == 0) &&
+                (header.strings_offset <= contents.length) &&
+                (header.strings_offset >= header.stream_offset + header.stream_size + CACHE_STREAM_PADDING) &&
+                (header.string_count <= (contents.length - header.strings_offset) / sizeof(u32));
+    }
+    // checked last, it is the only part that touches the whole source
+    if (valid) valid = header.source_hash == hash_source(source);
+
+    if (!valid)
+    {
+        unmap_file(&out->file);
+        return false;
+    }
+
+    out->source = source;
+    out->stream = (const u8*)contents.data + header.stream_offset;
+    out->stream_end = out->stream + header.stream_size;
+    out->string_ends = (const u32*)(contents.data + header.strings_offset);
+    out->string_data = contents.data + header.strings_offset + header.string_count * sizeof(u32);
+    out->string_count = header.string_count;
+    out->string_data_size = (contents.data + contents.length) - out->string_data;
+    out->token_count = header.token_count;
+    out->rewind();
+    return true;
+}
+
+// @note no bounds checks, a varint is at most 10 bytes and the stream is followed by
+// CACHE_STREAM_PADDING zero bytes, more than the largest token takes
+inline const u8 *get_varint(const u8 *at, u64 *value)
+{
+    u64 result = *at & 0x7F;
+    if (*at++ < 0x80)
+    {
+        *value = result;
+        return at;
+    }
+    for (int shift = 7; shift < 64; shift += 7)
+    {
+        u8 byte = *at++;
+        result |= (u64)(byte & 0x7F) << shift;
+        if (byte < 0x80) break;
+    }
+    *value = result;
+    return at;
+}
+
+inline const u8 *get_signed_varint(const u8 *at, s64 *value)
+{
+    u64 raw;
+    at = get_varint(at, &raw);
+    *value = (s64)(raw >> 1) ^ -(s64)(raw & 1);
+    return at;
+}
+
+b8 TokenCache::next(Token *out)
+{
+    if (cursor >= stream_end) return false;
+
+    const u8 *at = cursor;
+    u64 type, length, column, shape;
+    s64 offset_delta, line_delta;
+    at = get_varint(at, &type);
+    at = get_signed_varint(at, &offset_delta);
+    at = get_varint(at, &length);
+    at = get_signed_varint(at, &line_delta);
+    at = get_varint(at, &column);
+    at = get_varint(at, &shape);
+
+    // a literal cut off by the end of the file can end in the zero padding
+    u64 token_offset = (u64)((s64)offset + offset_delta);
+    u64 limit = source.length + LEXER_INPUT_PADDING;
+    if ((type > TokenType_ERROR) || (token_offset > limit) || (length > limit - token_offset)) return false;
+
+    out->type = (TokenType)type;
+    out->name = String();
+    out->source_offset = (u32)token_offset;
+    out->source_length = (u32)length;
+    out->line_start = line + (int)line_delta;
+    out->col_start = (int)column;
+    out->line_end = out->line_start;
+    out->col_end = out->col_start + (int)length;
+    out->flags = (int)(shape >> CACHE_TOKEN_SHAPE_BITS);
+    out->integer_value = 0;
+
+    if (shape & CACHE_TOKEN_MOVED_END)
+    {
+        s64 end_line;
+        u64 end_column;
+        at = get_signed_varint(at, &end_line);
+        at = get_varint(at, &end_column);
+        out->line_end = out->line_start + (int)end_line;
+        out->col_end = (int)end_column;
+    }
+    if (shape & CACHE_TOKEN_SOURCE_NAME)
+    {
+        u64 skip, name_length;
+        at = get_varint(at, &skip);
+        at = get_varint(at, &name_length);
+        if ((skip > length) || (name_length > length - skip)) return false;
+        out->name.data = source.data + token_offset + skip;
+        out->name.length = name_length;
+    }
+
+    if (out->type == TokenType_NUMBER)
+    {
+        // floats keep their exact bits
+        if (out->flags & LiteralNumber_FLOAT)
+        {
+            memcpy(&out->float_value, at, sizeof(f64));
+            at += sizeof(f64);
+        }
+        else
+        {
+            at = get_varint(at, &out->integer_value);
+        }
+    }
+    else if (has_table_name(out->type))
+    {
+        u64 index;
+        at = get_varint(at, &index);
+        if (index >= string_count) return false;
+        u64 start = index ? (u64)string_ends[index - 1] + 1 : 0;
+        u64 end = string_ends[index];
+        if ((start > end) || (end >= string_data_size)) return false;
+        // the lexer leaves empty string literals without data
+        if (end > start) out->name.data = (char*)string_data + start;
+        out->name.length = end - start;
+    }
+
+    // a damaged stream reads into the padding
+    if (at > stream_end) return false;
+
+    cursor = at;
+    offset = out->source_offset;
+    line = out->line_start;
+    return true;
+}
+
+void TokenCache::rewind(void)
+{
+    cursor = stream;
+    offset = 0;
+    line = 1;
+}
+
+void TokenCache::release(void)
+{
+    unmap_file(&file);
+    *this = TokenCache();
+}
\ No newline at end of file
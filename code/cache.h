@@ -0,0 +1,63 @@
+#pragma once
+
+#include "common.h"
+#include "lexer.h"
+#include "platform.h"
+
+#define TOKEN_CACHE_MAGIC   0x31434B54 // "TKC1"
+#define TOKEN_CACHE_VERSION 1
+
+// @note all fields are little endian. the header is followed by the token stream, CACHE_STREAM_PADDING
+// zero bytes and the string table
+struct TokenCacheHeader
+{
+    u32 magic;
+    u32 version;
+    u64 source_hash;
+    u64 source_length;
+    u64 token_count;
+    u64 stream_offset;
+    u64 stream_size;
+    u64 string_count;
+    u64 strings_offset; // u32 ends[string_count], then the bytes of every string
+};
+
+// tokens of one source saved to disk so an unchanged file does not have to be lexed again.
+// every token is a few varints: type, offset delta, length, line delta, column, flags,
+// then the value of a number or the string table index of an identifier or string literal.
+// unique identifier and string literal names are stored once in the string table.
+// @note the file is mapped and tokens are decoded from it one at a time, names of
+// identifiers and string literals point into the mapping, the names of other tokens
+// point into the source like the lexer's do. atoms are not stored
+struct TokenCache
+{
+    MappedFile file;
+    String source;
+
+    const u8 *stream = null;
+    const u8 *stream_end = null;
+    const u32 *string_ends = null;
+    const char *string_data = null;
+    u64 string_count = 0;
+    u64 string_data_size = 0;
+    u64 token_count = 0;
+
+    // position of the next token to decode
+    const u8 *cursor = null;
+    u32 offset = 0;
+    int line = 1;
+
+    // false once every token was returned or when the stream is damaged
+    b8 next(Token *out);
+    void rewind(void);
+    void release(void);
+};
+
+// hash of the whole source, what a cache is checked against
+u64 hash_source(String source);
+
+// writes the tokens lexed from source to path, with their positions tracked
+b8 write_token_cache(const char *path, String source, TokenArray *tokens);
+// maps the cache at path, false when it is missing or damaged or was written for a different source.
+// the source has to be padded like lexer input and stay around while the cache is used
+b8 open_token_cache(const char *path, String source, TokenCache *out);
\ No newline at end of file
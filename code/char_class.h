@@ -0,0 +1,57 @@
+#pragma once
+
+#include "common.h"
+
+enum CharClass
+{
+    CharClass_IDENT_START    = 0x1,
+    CharClass_IDENT_CONTINUE = 0x2,
+    CharClass_DIGIT          = 0x4,
+    CharClass_HEX_DIGIT      = 0x8,
+    CharClass_WHITESPACE     = 0x10,
+};
+
+struct CharClassTable
+{
+    u8 bits[256];
+};
+
+// @note only ascii is classified, bytes above 127 have no class.
+// this matches <ctype.h> in the "C" locale without the locale lookup
+constexpr CharClassTable make_char_class_table(void)
+{
+    CharClassTable result = {};
+
+    for (int c = 'a'; c <= 'z'; ++c) result.bits[c] |= CharClass_IDENT_START | CharClass_IDENT_CONTINUE;
+    for (int c = 'A'; c <= 'Z'; ++c) result.bits[c] |= CharClass_IDENT_START | CharClass_IDENT_CONTINUE;
+    result.bits['_'] |= CharClass_IDENT_START | CharClass_IDENT_CONTINUE;
+
+    for (int c = '0'; c <= '9'; ++c) result.bits[c] |= CharClass_DIGIT | CharClass_HEX_DIGIT | CharClass_IDENT_CONTINUE;
+    for (int c = 'a'; c <= 'f'; ++c) result.bits[c] |= CharClass_HEX_DIGIT;
+    for (int c = 'A'; c <= 'F'; ++c) result.bits[c] |= CharClass_HEX_DIGIT;
+
+    const char *whitespace = " \t\n\v\f\r";
+    for (const char *at = whitespace; *at; ++at) result.bits[(u8)*at] |= CharClass_WHITESPACE;
+
+    return result;
+}
+
+constexpr CharClassTable char_class_table = make_char_class_table();
+
+// @note c is a byte, a negative char works too since the cast takes it to 128..255.
+// the end of input reads as the 0 sentinel, which has no class
+inline b8 char_is(int c, u8 char_class)
+{
+    return (char_class_table.bits[(u8)c] & char_class) != 0;
+}
+
+inline b8 is_digit(int c)      { return char_is(c, CharClass_DIGIT); }
+inline b8 is_hex_digit(int c)  { return char_is(c, CharClass_HEX_DIGIT); }
+inline b8 is_whitespace(int c) { return char_is(c, CharClass_WHITESPACE); }
+
+// c must be a hex digit
+inline int hex_digit_value(int c)
+{
+    if (c <= '9') return c - '0';
+    return (c | 0x20) - 'a' + 10;
+}
\ No newline at end of file
@@ -0,0 +1,494 @@
+#include "corpus.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// no profile writes more than this in one step, so steps are written without checking for room
+#define CORPUS_MAX_STEP (32 * 1024)
+
+static const char *corpus_keywords[] = {
+    "alias", "as", "auto_cast", "break", "case", "cast", "const", "continue", "defer", "else",
+    "enum", "extern", "false", "for", "function", "if", "inline", "null", "return", "struct",
+    "switch", "then", "true", "using", "while", "u32", "s64", "float", "int", "bool",
+};
+
+static const char *corpus_operators[] = {
+    "+", "-", "*", "/", "%", "=", "<", ">", "!", "&", "|", "^", "~", "(", ")", "{", "}", "[", "]",
+    ";", ",", ":", ".", "+=", "-=", "*=", "/=", "%=", "==", "!=", "<=", ">=", "&&", "||", "&=",
+    "|=", "<<", ">>", "<<=", ">>=", "..", "->",
+};
+
+static const char *corpus_assignments[] = {
+    "=", "+=", "-=", "*=", "/=", "%=", "&=", "|=", "<<=", ">>=",
+};
+
+static const char *corpus_binary_operators[] = {
+    "+", "-", "*", "/", "%", "<", ">", "<=", ">=", "==", "!=", "&&", "||", "&", "|", "^", "<<", ">>",
+};
+
+static const char *corpus_words[] = {
+    "the", "table", "entry", "is", "updated", "when", "count", "changes", "see", "below",
+    "returns", "index", "of", "first", "match", "or", "negative", "one", "@note", "@todo",
+};
+
+#define ARRAY_COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+struct CorpusWriter
+{
+    char *data = null;
+    u64 length = 0;
+    u64 allocated = 0;
+    u64 random_state = 0;
+
+    // xorshift, the same on every platform
+    u64 random(u64 range)
+    {
+        random_state ^= random_state << 13;
+        random_state ^= random_state >> 7;
+        random_state ^= random_state << 17;
+        return random_state % range;
+    }
+
+    b8 chance(int percent) { return (int)random(100) < percent; }
+
+    void put(char c) { data[length++] = c; }
+
+    void put(const char *text)
+    {
+        u64 size = strlen(text);
+        memcpy(data + length, text, size);
+        length += size;
+    }
+
+    void put_indent(int depth)
+    {
+        for (int i = 0; i < depth; ++i) put("    ");
+    }
+
+    void put_identifier(void)
+    {
+        static const char first[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_";
+        static const char rest[]  = "abcdefghijklmnopqrstuvwxyz_0123456789";
+
+        // mostly short names with a tail of long ones
+        u64 size = 1 + random(4) + random(4) * random(5);
+        put(first[random(sizeof(first) - 1)]);
+        for (u64 i = 1; i < size; ++i) put(rest[random(sizeof(rest) - 1)]);
+    }
+
+    void put_name(void)
+    {
+        if (chance(15)) put(corpus_keywords[random(ARRAY_COUNT(corpus_keywords))]);
+        else put_identifier();
+    }
+
+    void put_digits(const char *digits, u64 count, b8 separators)
+    {
+        u64 digit_count = strlen(digits);
+        for (u64 i = 0; i < count; ++i)
+        {
+            if (separators && i && ((count - i) % 4 == 0)) put('_');
+            put(digits[random(digit_count)]);
+        }
+    }
+
+    void put_number(void)
+    {
+        b8 separators = chance(20);
+        switch (random(6))
+        {
+            case 0:
+            {
+                put("0x");
+                put_digits("0123456789abcdefABCDEF", 1 + random(16), separators);
+            } break;
+
+            case 1:
+            {
+                put("0b");
+                put_digits("01", 1 + random(32), separators);
+            } break;
+
+            case 2:
+            {
+                put_digits("0123456789", 1 + random(6), false);
+                put('.');
+                put_digits("0123456789", 1 + random(10), false);
+                if (chance(30))
+                {
+                    put(chance(50) ? "e+" : "e-");
+                    put_digits("0123456789", 1 + random(2), false);
+                }
+            } break;
+
+            default:
+            {
+                // no leading zeros, the first digit is never 0
+                put("123456789"[random(9)]);
+                put_digits("0123456789", random(12), separators);
+            } break;
+        }
+    }
+
+    void put_string(void)
+    {
+        static const char plain[] = "abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ 0123456789 .,:;!?%#-+=()[]{}";
+        static const char *escapes[] = { "\\n", "\\t", "\\\\", "\\\"", "\\x41", "\\0", "\\r" };
+
+        put('"');
+        u64 size = random(48);
+        for (u64 i = 0; i < size; ++i)
+        {
+            if (chance(6)) put(escapes[random(ARRAY_COUNT(escapes))]);
+            else put(plain[random(sizeof(plain) - 1)]);
+        }
+        put('"');
+    }
+
+    void put_words(u64 count)
+    {
+        for (u64 i = 0; i < count; ++i)
+        {
+            put(' ');
+            put(corpus_words[random(ARRAY_COUNT(corpus_words))]);
+        }
+    }
+
+    void put_expression(void)
+    {
+        u64 terms = 1 + random(4);
+        for (u64 i = 0; i < terms; ++i)
+        {
+            if (i)
+            {
+                put(' ');
+                put("+-*&|^"[random(6)]);
+                put(' ');
+            }
+            if (chance(40)) put_number();
+            else put_identifier();
+        }
+    }
+};
+
+/////////////////////////////////////////////////////////
+// one or more lines of every profile
+static void put_identifier_line(CorpusWriter *w)
+{
+    u64 count = 8 + w->random(9);
+    for (u64 i = 0; i < count; ++i)
+    {
+        if (i) w->put(' ');
+        w->put_name();
+    }
+    w->put('\n');
+}
+
+static void put_number_line(CorpusWriter *w)
+{
+    w->put("    { ");
+    u64 count = 4 + w->random(5);
+    for (u64 i = 0; i < count; ++i)
+    {
+        if (i) w->put(", ");
+        w->put_number();
+    }
+    w->put(" },\n");
+}
+
+static void put_string_line(CorpusWriter *w)
+{
+    w->put("    print(");
+    u64 count = 1 + w->random(3);
+    for (u64 i = 0; i < count; ++i)
+    {
+        if (i) w->put(", ");
+        w->put_string();
+    }
+    w->put(");\n");
+}
+
+static void put_comment_lines(CorpusWriter *w)
+{
+    switch (w->random(4))
+    {
+        case 0:
+        {
+            w->put("/*\n");
+            u64 lines = 1 + w->random(6);
+            for (u64 i = 0; i < lines; ++i)
+            {
+                w->put(" *");
+                w->put_words(2 + w->random(10));
+                w->put('\n');
+            }
+            w->put(" */\n");
+        } break;
+
+        case 1:
+        {
+            // code with a comment behind it
+            w->put("    ");
+            w->put_identifier();
+            w->put(" := ");
+            w->put_number();
+            w->put(";    //");
+            w->put_words(2 + w->random(6));
+            w->put('\n');
+        } break;
+
+        default:
+        {
+            w->put_indent((int)w->random(3));
+            w->put("//");
+            w->put_words(3 + w->random(12));
+            w->put('\n');
+        } break;
+    }
+}
+
+static void put_operator_line(CorpusWriter *w)
+{
+    u64 count = 16 + w->random(17);
+    b8 needs_space = false;
+    for (u64 i = 0; i < count; ++i)
+    {
+        const char *op = corpus_operators[w->random(ARRAY_COUNT(corpus_operators))];
+        // never glue a '/' to a following '/' or '*', that would start a comment
+        if (needs_space || w->chance(30)) w->put(' ');
+        w->put(op);
+        needs_space = op[strlen(op) - 1] == '/';
+    }
+    w->put('\n');
+}
+
+static void put_expression_line(CorpusWriter *w)
+{
+    w->put_indent(1);
+    w->put_identifier();
+    w->put(corpus_assignments[w->random(ARRAY_COUNT(corpus_assignments))]);
+
+    // operands never start with '/' or '*', so no operator in front of one starts a comment
+    u64 terms = 3 + w->random(10);
+    for (u64 i = 0; i < terms; ++i)
+    {
+        if (i) w->put(corpus_binary_operators[w->random(ARRAY_COUNT(corpus_binary_operators))]);
+        if (w->chance(15)) w->put("!~-"[w->random(3)]);
+        switch (w->random(6))
+        {
+            case 0:
+            {
+                w->put_identifier();
+                w->put("->");
+                w->put_identifier();
+            } break;
+
+            case 1:
+            {
+                w->put_identifier();
+                w->put('[');
+                w->put_identifier();
+                w->put(']');
+            } break;
+
+            case 2:
+            {
+                w->put('(');
+                w->put_identifier();
+                w->put(corpus_binary_operators[w->random(ARRAY_COUNT(corpus_binary_operators))]);
+                w->put_identifier();
+                w->put(')');
+            } break;
+
+            case 3: w->put_number(); break;
+            default: w->put_identifier(); break;
+        }
+    }
+    w->put(";\n");
+}
+
+static void put_whitespace_lines(CorpusWriter *w)
+{
+    // blank lines with trailing whitespace, then one deeply indented statement
+    u64 blank = w->random(3);
+    for (u64 i = 0; i < blank; ++i)
+    {
+        u64 trailing = w->random(40);
+        for (u64 j = 0; j < trailing; ++j) w->put(w->chance(80) ? ' ' : '\t');
+        w->put(w->chance(10) ? "\r\n" : "\n");
+    }
+
+    u64 indent = w->random(120);
+    for (u64 i = 0; i < indent; ++i) w->put(w->chance(90) ? ' ' : '\t');
+    switch (w->random(3))
+    {
+        case 0:  w->put('{'); break;
+        case 1:  w->put('}'); break;
+        default: w->put_identifier(); w->put(';'); break;
+    }
+    w->put('\n');
+}
+
+static void put_function(CorpusWriter *w)
+{
+    if (w->chance(50))
+    {
+        w->put("//");
+        w->put_words(3 + w->random(8));
+        w->put('\n');
+    }
+
+    w->put("function ");
+    w->put_identifier();
+    w->put('(');
+    u64 parameters = w->random(4);
+    for (u64 i = 0; i < parameters; ++i)
+    {
+        if (i) w->put(", ");
+        w->put_identifier();
+        w->put(w->chance(50) ? ": int" : ": float");
+    }
+    w->put(")\n{\n");
+
+    int depth = 1;
+    u64 statements = 3 + w->random(12);
+    for (u64 i = 0; i < statements; ++i)
+    {
+        w->put_indent(depth);
+        switch (w->random(8))
+        {
+            case 0:
+            {
+                w->put("if ");
+                w->put_identifier();
+                w->put(w->chance(50) ? " >= " : " != ");
+                w->put_number();
+                w->put(" && ");
+                w->put_identifier();
+                w->put(" then print(");
+                w->put_string();
+                w->put(", ");
+                w->put_identifier();
+                w->put(");\n");
+            } break;
+
+            case 1:
+            {
+                w->put("for i: 0..");
+                w->put_identifier();
+                w->put(" { ");
+                w->put_identifier();
+                w->put(" += i << 2; }\n");
+            } break;
+
+            case 2:
+            {
+                w->put("//");
+                w->put_words(2 + w->random(8));
+                w->put('\n');
+            } break;
+
+            case 3:
+            {
+                if (depth < 4)
+                {
+                    w->put("while ");
+                    w->put_identifier();
+                    w->put(" < ");
+                    w->put_number();
+                    w->put("\n");
+                    w->put_indent(depth);
+                    w->put("{\n");
+                    depth += 1;
+                }
+                else
+                {
+                    w->put("break;\n");
+                }
+            } break;
+
+            case 4:
+            {
+                if (depth > 1)
+                {
+                    depth -= 1;
+                    w->put("}\n");
+                }
+                else
+                {
+                    w->put("defer free(");
+                    w->put_identifier();
+                    w->put(");\n");
+                }
+            } break;
+
+            default:
+            {
+                w->put_identifier();
+                w->put(w->chance(50) ? " := " : " = ");
+                if (w->chance(20)) w->put("cast(int) ");
+                w->put_expression();
+                w->put(";\n");
+            } break;
+        }
+    }
+    while (depth > 1)
+    {
+        depth -= 1;
+        w->put_indent(depth);
+        w->put("}\n");
+    }
+
+    w->put("    return ");
+    w->put_expression();
+    w->put(";\n}\n\n");
+}
+
+/////////////////////////////////////////////////////////
+const char *corpus_profile_name(CorpusProfile profile)
+{
+    switch (profile)
+    {
+        case CorpusProfile_IDENTIFIERS: return "identifiers";
+        case CorpusProfile_NUMBERS:     return "numbers";
+        case CorpusProfile_STRINGS:     return "strings";
+        case CorpusProfile_COMMENTS:    return "comments";
+        case CorpusProfile_OPERATORS:   return "operators";
+        case CorpusProfile_EXPRESSIONS: return "expressions";
+        case CorpusProfile_WHITESPACE:  return "whitespace";
+        case CorpusProfile_MIXED:       return "mixed";
+        default:                        return "unknown";
+    }
+}
+
+String generate_corpus(CorpusProfile profile, u64 size, u64 seed)
+{
+    CorpusWriter w;
+    // xorshift gets stuck on 0
+    w.random_state = seed * 0x9E3779B97F4A7C15ull + 1;
+    w.allocated = size + CORPUS_MAX_STEP + LEXER_INPUT_PADDING;
+    w.data = (char*)malloc(w.allocated);
+
+    String result;
+    if (!w.data) return result;
+
+    while (w.length < size)
+    {
+        switch (profile)
+        {
+            case CorpusProfile_IDENTIFIERS: put_identifier_line(&w); break;
+            case CorpusProfile_NUMBERS:     put_number_line(&w); break;
+            case CorpusProfile_STRINGS:     put_string_line(&w); break;
+            case CorpusProfile_COMMENTS:    put_comment_lines(&w); break;
+            case CorpusProfile_OPERATORS:   put_operator_line(&w); break;
+            case CorpusProfile_EXPRESSIONS: put_expression_line(&w); break;
+            case CorpusProfile_WHITESPACE:  put_whitespace_lines(&w); break;
+            default:                        put_function(&w); break;
+        }
+    }
+
+    memset(w.data + w.length, 0, LEXER_INPUT_PADDING);
+    result.data = w.data;
+    result.length = w.length;
+    return result;
+}
\ No newline at end of file
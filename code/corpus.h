@@ -0,0 +1,26 @@
+#pragma once
+
+#include "common.h"
+#include "lexer.h"
+
+// kinds of generated source, each one dominated by one kind of token
+enum CorpusProfile
+{
+    CorpusProfile_IDENTIFIERS,
+    CorpusProfile_NUMBERS,
+    CorpusProfile_STRINGS,
+    CorpusProfile_COMMENTS,
+    CorpusProfile_OPERATORS,
+    CorpusProfile_EXPRESSIONS, // long expressions without spaces, like our generated expression code
+    CorpusProfile_WHITESPACE,
+    CorpusProfile_MIXED, // functions with a bit of everything, like hand written code
+
+    CorpusProfile_COUNT
+};
+
+const char *corpus_profile_name(CorpusProfile profile);
+
+// lexically valid source of at least 'size' bytes, it ends at a line boundary shortly after.
+// the same profile, size and seed give the same bytes on every machine.
+// @note the data is followed by LEXER_INPUT_PADDING zero bytes, release it with free
+String generate_corpus(CorpusProfile profile, u64 size, u64 seed);
\ No newline at end of file
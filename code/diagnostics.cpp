@@ -0,0 +1,122 @@
+#include "diagnostics.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+void TextBuffer::append(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    append_arguments(format, args);
+    va_end(args);
+}
+
+void TextBuffer::append_arguments(const char *format, va_list args)
+{
+    va_list copy;
+    va_copy(copy, args);
+    int needed = vsnprintf(null, 0, format, copy);
+    va_end(copy);
+    if (needed <= 0) return;
+
+    if (length + needed + 1 > allocated)
+    {
+        u64 new_allocated = allocated ? allocated * 2 : 256;
+        while (new_allocated < length + needed + 1) new_allocated *= 2;
+
+        char *new_data = (char*)realloc(data, new_allocated);
+        assert(new_data);
+        data = new_data;
+        allocated = new_allocated;
+    }
+
+    vsnprintf(data + length, allocated - length, format, args);
+    length += needed;
+}
+
+void TextBuffer::release(void)
+{
+    free(data);
+    data = null;
+    length = 0;
+    allocated = 0;
+}
+
+/////////////////////////////////////////////////////////
+const char *diagnostic_message(DiagnosticCode code)
+{
+    switch (code)
+    {
+        case Diagnostic_UNTERMINATED_COMMENT: return "Reached end of file from within a comment.";
+        case Diagnostic_TWO_DECIMAL_POINTS: return "Can't have two decimal points in a number";
+        case Diagnostic_TWO_EXPONENTS: return "Can't have two exponents in a number";
+        case Diagnostic_BAD_EXPONENT: return "'e' in float literals must be followed by '+' or '-' or a numerical digit";
+        case Diagnostic_FLOAT_TOO_LARGE: return "Float literal is too large.";
+        case Diagnostic_INTEGER_TOO_LARGE: return "Integer literal does not fit in 64 bits.";
+        case Diagnostic_BINARY_DECIMAL_POINT: return "Can't have a decimal point in a binary number";
+        case Diagnostic_INVALID_BINARY_DIGIT: return "Invalid digit in a binary number";
+        case Diagnostic_HEXADECIMAL_DECIMAL_POINT: return "Can't have a decimal point in a hexadecimal number";
+        case Diagnostic_UNTERMINATED_STRING: return "Reached end of file within a string literal.";
+        case Diagnostic_NEW_LINE_IN_STRING: return "Reached new line within a string literal.";
+        case Diagnostic_DECIMAL_ESCAPE_TOO_LARGE: return "Decimal value of '%d' exceeds the limit.";
+        case Diagnostic_UNKNOWN_ESCAPE: return "Unknown escape sequence '\\%c' in string literal.";
+        case Diagnostic_INVALID_DECIMAL_ESCAPE: return "Invalid decimal digit.\n\\d must be followed by 3 decimal digits.";
+        case Diagnostic_INVALID_HEXADECIMAL_ESCAPE: return "Invalid hexadecimal digit.\n\\x must be followed by 2 hexadecimal digits.";
+        default: return "Unknown error.";
+    }
+}
+
+Diagnostic *Diagnostics::add(void)
+{
+    if (count >= allocated)
+    {
+        s64 new_allocated = allocated ? allocated * 2 : 16;
+        Diagnostic *new_data = (Diagnostic*)realloc(data, new_allocated * sizeof(Diagnostic));
+        assert(new_data);
+        data = new_data;
+        allocated = new_allocated;
+    }
+
+    Diagnostic *result = &data[count++];
+    *result = Diagnostic();
+    return result;
+}
+
+void Diagnostics::take(Diagnostics *other)
+{
+    for (s64 i = 0; i < other->count; ++i) *add() = other->data[i];
+    other->count = 0;
+}
+
+void Diagnostics::format(TextBuffer *out, const char *const *file_names)
+{
+    for (s64 i = 0; i < count; ++i)
+    {
+        Diagnostic *diagnostic = &data[i];
+        const char *file_name = file_names ? file_names[diagnostic->file_id] : "<filename>";
+
+        out->append("%s:%d:%d: Error: ", file_name, diagnostic->line, diagnostic->column);
+        // every message takes at most one argument
+        out->append(diagnostic_message(diagnostic->code), (int)diagnostic->argument);
+        out->append("\n");
+    }
+}
+
+void Diagnostics::emit(FILE *out, const char *const *file_names)
+{
+    if (!count) return;
+
+    TextBuffer text;
+    format(&text, file_names);
+    fwrite(text.data, 1, text.length, out);
+    text.release();
+}
+
+void Diagnostics::release(void)
+{
+    free(data);
+    data = null;
+    count = 0;
+    allocated = 0;
+}
\ No newline at end of file
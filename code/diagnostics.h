@@ -0,0 +1,73 @@
+#pragma once
+
+#include "common.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+// growable text, diagnostics are formatted into one before they are written out
+struct TextBuffer
+{
+    char *data = null;
+    u64 length = 0;
+    u64 allocated = 0;
+
+    void append(const char *format, ...);
+    void append_arguments(const char *format, va_list args);
+    void release(void);
+};
+
+enum DiagnosticCode
+{
+    Diagnostic_UNTERMINATED_COMMENT,
+    Diagnostic_TWO_DECIMAL_POINTS,
+    Diagnostic_TWO_EXPONENTS,
+    Diagnostic_BAD_EXPONENT,
+    Diagnostic_FLOAT_TOO_LARGE,
+    Diagnostic_INTEGER_TOO_LARGE,
+    Diagnostic_BINARY_DECIMAL_POINT,
+    Diagnostic_INVALID_BINARY_DIGIT,
+    Diagnostic_HEXADECIMAL_DECIMAL_POINT,
+    Diagnostic_UNTERMINATED_STRING,
+    Diagnostic_NEW_LINE_IN_STRING,
+    Diagnostic_DECIMAL_ESCAPE_TOO_LARGE, // argument: the value
+    Diagnostic_UNKNOWN_ESCAPE,           // argument: the character after '\'
+    Diagnostic_INVALID_DECIMAL_ESCAPE,
+    Diagnostic_INVALID_HEXADECIMAL_ESCAPE,
+
+    Diagnostic_COUNT
+};
+
+// @note nothing is formatted when a diagnostic is reported, the message is put
+// together from its code and argument only when it is emitted
+struct Diagnostic
+{
+    DiagnosticCode code = Diagnostic_UNTERMINATED_COMMENT;
+    u32 file_id = 0;
+
+    // span in the input
+    u32 offset = 0;
+    u32 length = 0;
+    int line = 0;
+    int column = 0;
+
+    s64 argument = 0;
+};
+
+struct Diagnostics
+{
+    Diagnostic *data = null;
+    s64 count = 0;
+    s64 allocated = 0;
+
+    Diagnostic *add(void);
+    // appends all of 'other' and empties it
+    void take(Diagnostics *other);
+    // file_names[file_id] names the file, or "<filename>" when there are none
+    void format(TextBuffer *out, const char *const *file_names);
+    // formats everything and writes it with a single call
+    void emit(FILE *out, const char *const *file_names = null);
+    void release(void);
+};
+
+const char *diagnostic_message(DiagnosticCode code);
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "driver.h"
+
+#define DRIVER_MAX_THREADS 64
+
+// @note every worker owns a range of file indices packed as begin << 32 | end.
+// the owner takes files from the front, an idle worker steals the back half of
+// somebody else's range. both sides only change a range with a compare exchange.
+struct FileQueue
+{
+    volatile s64 range = 0;
+    char pad[64 - sizeof(s64)]; // keep the ranges on their own cache lines
+};
+
+struct LexWorker
+{
+    int index = 0;
+    int worker_count = 0;
+    FileQueue *queues = null;
+    LexedFile *files = null;
+    u64 populate_threshold = 0;
+    Thread thread;
+};
+
+static s64 pack_range(s64 begin, s64 end)
+{
+    return (begin << 32) | end;
+}
+
+static s64 range_begin(s64 range)
+{
+    return range >> 32;
+}
+
+static s64 range_end(s64 range)
+{
+    return range & 0xffffffff;
+}
+
+static s64 take_file(FileQueue *queue)
+{
+    while (true)
+    {
+        s64 range = atomic_load(&queue->range);
+        s64 begin = range_begin(range);
+        s64 end = range_end(range);
+        if (begin >= end) return -1;
+
+        if (atomic_compare_exchange(&queue->range, range, pack_range(begin + 1, end)) == range) return begin;
+    }
+}
+
+// moves the back half of a victim's files into our queue and returns the first of them
+static s64 steal_files(LexWorker *worker)
+{
+    for (int i = 1; i < worker->worker_count; ++i)
+    {
+        FileQueue *victim = &worker->queues[(worker->index + i) % worker->worker_count];
+        while (true)
+        {
+            s64 range = atomic_load(&victim->range);
+            s64 begin = range_begin(range);
+            s64 end = range_end(range);
+            if (begin >= end) break;
+
+            s64 stolen = (end - begin + 1) / 2;
+            if (atomic_compare_exchange(&victim->range, range, pack_range(begin, end - stolen)) != range) continue;
+
+            // our own range is empty, so no one else is touching it
+            FileQueue *own = &worker->queues[worker->index];
+            s64 own_range = atomic_load(&own->range);
+            atomic_compare_exchange(&own->range, own_range, pack_range(end - stolen + 1, end));
+            return end - stolen;
+        }
+    }
+    return -1;
+}
+
+static void lex_file(Lexer *lexer, LexedFile *file, u32 file_id, u64 populate_threshold)
+{
+    f64 start = get_wall_clock();
+
+    file->could_open = map_file(file->path, &file->file, LEXER_INPUT_PADDING, populate_threshold);
+    if (!file->could_open) return;
+
+    lexer->initialize(file->file.contents, true);
+    lexer->file_id = file_id;
+    lexer->diagnostics = &file->diagnostics;
+    file->succeeded = lexer->tokenize(&file->tokens);
+
+    file->seconds = get_wall_clock() - start;
+}
+
+static void lex_worker(void *data)
+{
+    LexWorker *worker = (LexWorker*)data;
+
+    // one lexer per worker, its buffers are reused for every file
+    Lexer lexer;
+    while (true)
+    {
+        s64 index = take_file(&worker->queues[worker->index]);
+        if (index < 0) index = steal_files(worker);
+        if (index < 0) break;
+
+        lex_file(&lexer, &worker->files[index], (u32)index, worker->populate_threshold);
+    }
+    lexer.deinitialize();
+}
+
+b8 lex_files(LexedFile *files, int count, int thread_count, u64 populate_threshold)
+{
+    if (thread_count > DRIVER_MAX_THREADS) thread_count = DRIVER_MAX_THREADS;
+    if (thread_count > count) thread_count = count;
+    if (thread_count < 1) thread_count = 1;
+
+    FileQueue queues[DRIVER_MAX_THREADS];
+    LexWorker workers[DRIVER_MAX_THREADS];
+    for (int i = 0; i < thread_count; ++i)
+    {
+        s64 begin = (s64)count * i / thread_count;
+        s64 end = (s64)count * (i + 1) / thread_count;
+        queues[i].range = pack_range(begin, end);
+
+        LexWorker *worker = &workers[i];
+        worker->index = i;
+        worker->worker_count = thread_count;
+        worker->queues = queues;
+        worker->files = files;
+        worker->populate_threshold = populate_threshold;
+    }
+
+    // a worker that could not be started simply leaves its files to be stolen
+    for (int i = 1; i < thread_count; ++i) start_thread(&workers[i].thread, lex_worker, &workers[i]);
+    lex_worker(&workers[0]);
+    for (int i = 1; i < thread_count; ++i)
+    {
+        if (workers[i].thread.handle) join_thread(&workers[i].thread);
+    }
+
+    b8 result = true;
+    for (int i = 0; i < count; ++i)
+    {
+        if (!files[i].succeeded) result = false;
+    }
+    return result;
+}
+
+void release_lexed_file(LexedFile *file)
+{
+    file->tokens.release();
+    file->diagnostics.release();
+    if (file->could_open) unmap_file(&file->file);
+    file->could_open = false;
+}
\ No newline at end of file
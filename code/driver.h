@@ -0,0 +1,23 @@
+#pragma once
+
+#include "common.h"
+#include "lexer.h"
+#include "platform.h"
+
+// one input of lex_files, the results stay valid until release_lexed_file
+struct LexedFile
+{
+    const char *path = null;
+
+    MappedFile file; // token names point into the mapping
+    TokenArray tokens;
+    Diagnostics diagnostics; // file_id is the index in the list given to lex_files
+
+    f64 seconds = 0;
+    b8 could_open = false;
+    b8 succeeded = false;
+};
+
+// lexes every file on a pool of thread_count threads (the calling thread included)
+b8 lex_files(LexedFile *files, int count, int thread_count, u64 populate_threshold);
+void release_lexed_file(LexedFile *file);
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "lexer.h"
+
+#include <assert.h>
+#include <string.h>
+
+// how far past the end of a token the makers peek, '1..' looks at two characters after '1'
+#define RELEX_LOOKAHEAD 2
+
+// replaced payloads that pile up in TokenArray::strings before it is compacted. compacting
+// walks all tokens, so it runs at most once per this many bytes of edited escaped strings
+#define RELEX_UNUSED_STRINGS_LIMIT (64 * 1024)
+
+// @note nothing but the position crosses a token boundary: comments are skipped whole
+// between tokens and strings end at a new line. so lexing from any old token start gives
+// the old tokens again, and once the new stream reaches the (shifted) start of an old
+// token behind the edit, the rest of the old tokens are still correct.
+
+static b8 points_into(String name, String source)
+{
+    return name.data && (name.data >= source.data) && (name.data <= source.data + source.length);
+}
+
+// what a payload takes up in the arena, which hands out 8 byte aligned copies with a 0 after them
+static u64 payload_size(String name)
+{
+    return (name.length + 1 + 7) & ~7ull;
+}
+
+// moves the payloads that are still used into a new arena and frees the old one.
+// every name outside of source is a payload, relex_edit moved all others into source
+static void compact_strings(TokenArray *tokens, String source)
+{
+    Arena compacted;
+    compacted.block_size = tokens->strings.block_size;
+    for (s64 i = 0; i < tokens->count; ++i)
+    {
+        Token *token = &tokens->data[i];
+        if (!token->name.data || points_into(token->name, source)) continue;
+        token->name.data = compacted.copy_string(token->name.data, token->name.length);
+    }
+
+    tokens->strings.release();
+    tokens->strings = compacted;
+    tokens->unused_string_bytes = 0;
+}
+
+b8 relex_edit(TokenArray *tokens, String old_source, String new_source, TextEdit edit)
+{
+    assert(tokens->count > 0);
+    assert(new_source.length == old_source.length - edit.deleted_length + edit.inserted_length);
+
+    s64 delta = (s64)edit.inserted_length - (s64)edit.deleted_length;
+    u64 edit_end = edit.offset + edit.deleted_length;
+    s64 rebase = new_source.data - old_source.data;
+
+    // the first token that might have looked at the edited text, lexing restarts
+    // at the one in front of it, which could not have
+    s64 low = 0;
+    s64 high = tokens->count;
+    while (low < high)
+    {
+        s64 middle = (low + high) / 2;
+        Token *token = &tokens->data[middle];
+        if ((u64)token->source_offset + token->source_length + RELEX_LOOKAHEAD < edit.offset) low = middle + 1;
+        else high = middle;
+    }
+    s64 first = (low > 0) ? low - 1 : 0;
+
+    // the first old token completely behind the edit
+    s64 next_old = first;
+    while ((next_old < tokens->count) && (tokens->data[next_old].source_offset < edit_end)) ++next_old;
+
+    Lexer lexer;
+    lexer.initialize(new_source, true);
+    if (first > 0)
+    {
+        Token *restart = &tokens->data[first];
+        lexer.input_cursor = new_source.data + restart->source_offset;
+        lexer.current_line_number = restart->line_start;
+        lexer.current_character_index = restart->col_start;
+    }
+
+    TokenArray fresh;
+    fresh.reserve(64);
+    lexer.token_output = &fresh;
+    lexer.string_arena = &tokens->strings;
+
+    b8 in_sync = false;
+    Token sync;
+    while (true)
+    {
+        Token *token = lexer.generate_token();
+        while ((next_old < tokens->count) && ((s64)tokens->data[next_old].source_offset + delta < (s64)token->source_offset))
+        {
+            ++next_old;
+        }
+
+        if ((next_old < tokens->count) && ((s64)tokens->data[next_old].source_offset + delta == (s64)token->source_offset))
+        {
+            sync = *token;
+            fresh.count -= 1;
+            in_sync = true;
+            break;
+        }
+        if (token->type == TokenType_END_OF_FILE)
+        {
+            next_old = tokens->count;
+            break;
+        }
+    }
+
+    // payloads of the replaced tokens stay in the arena until it is compacted
+    for (s64 i = first; i < next_old; ++i)
+    {
+        Token *token = &tokens->data[i];
+        if (token->name.data && !points_into(token->name, old_source)) tokens->unused_string_bytes += payload_size(token->name);
+    }
+    // the old token behind the edit is kept, the sync token was decoded again for nothing
+    if (in_sync && sync.name.data && !points_into(sync.name, new_source)) tokens->unused_string_bytes += payload_size(sync.name);
+
+    // replace the old tokens [first, next_old) with the fresh ones
+    s64 tail_count = tokens->count - next_old;
+    s64 new_count = first + fresh.count + tail_count;
+    tokens->reserve(new_count);
+    Token *tail = tokens->data + first + fresh.count;
+    if (fresh.count != next_old - first)
+    {
+        memmove(tail, tokens->data + next_old, tail_count * sizeof(Token));
+    }
+    memcpy(tokens->data + first, fresh.data, fresh.count * sizeof(Token));
+    tokens->count = new_count;
+    fresh.release();
+
+    if (rebase)
+    {
+        for (s64 i = 0; i < first; ++i)
+        {
+            Token *token = &tokens->data[i];
+            if (points_into(token->name, old_source)) token->name.data += rebase;
+        }
+    }
+
+    if (in_sync)
+    {
+        // the tail moves by the edit, columns only on the line the edit ended on
+        int old_line = tail[0].line_start;
+        int line_delta = sync.line_start - old_line;
+        int col_delta = sync.col_start - tail[0].col_start;
+
+        for (s64 i = 0; i < tail_count; ++i)
+        {
+            Token *token = &tail[i];
+            if (points_into(token->name, old_source)) token->name.data += rebase + delta;
+            token->source_offset = (u32)(token->source_offset + delta);
+            if (token->line_start == old_line) token->col_start += col_delta;
+            if (token->line_end == old_line) token->col_end += col_delta;
+            token->line_start += line_delta;
+            token->line_end += line_delta;
+        }
+    }
+
+    if (tokens->unused_string_bytes > RELEX_UNUSED_STRINGS_LIMIT) compact_strings(tokens, new_source);
+
+    return !lexer.error_count;
+}
\ No newline at end of file
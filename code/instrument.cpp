@@ -0,0 +1,73 @@
+#include "instrument.h"
+
+thread_local LexerStats lexer_stats;
+
+static const char *instrument_bytes_names[InstrumentBytes_COUNT] = {
+    "whitespace", "comments", "identifiers", "numbers", "strings", "operators", "errors",
+};
+
+static const char *instrument_section_names[InstrumentSection_COUNT] = {
+    "whitespace", "line comment", "block comment", "make_identifier", "check_for_keyword", "make_number",
+    "make_binary_number", "make_hex_number", "make_string", "operators", "make_one_character_token",
+};
+
+void reset_lexer_stats(void)
+{
+    lexer_stats = LexerStats();
+}
+
+static f64 percent_of(u64 part, u64 whole)
+{
+    return whole ? 100.0 * (f64)part / (f64)whole : 0.0;
+}
+
+void report_lexer_stats(FILE *out)
+{
+    if (!LEXER_INSTRUMENT)
+    {
+        fprintf(out, "lexer stats: not compiled in, build with -DLEXER_INSTRUMENT=1\n");
+        return;
+    }
+
+    LexerStats *stats = &lexer_stats;
+
+    u64 token_count = 0;
+    for (int i = 0; i <= TokenType_ERROR; ++i) token_count += stats->tokens[i];
+    fprintf(out, "tokens: %llu\n", token_count);
+    for (int i = 0; i <= TokenType_ERROR; ++i)
+    {
+        u64 count = stats->tokens[i];
+        if (!count) continue;
+
+        // ascii tokens are their character
+        if (i < TokenType_IDENTIFIER) fprintf(out, "    '%c'", (char)i);
+        else fprintf(out, "    %s", token_type_strings((TokenType)i));
+        fprintf(out, " %llu (%.1f%%)\n", count, percent_of(count, token_count));
+    }
+
+    u64 byte_count = 0;
+    for (int i = 0; i < InstrumentBytes_COUNT; ++i) byte_count += stats->bytes[i];
+    fprintf(out, "bytes: %llu\n", byte_count);
+    for (int i = 0; i < InstrumentBytes_COUNT; ++i)
+    {
+        fprintf(out, "    %-12s %12llu (%.1f%%)\n", instrument_bytes_names[i], stats->bytes[i],
+                percent_of(stats->bytes[i], byte_count));
+    }
+
+    u64 lookups = stats->keyword_hits + stats->keyword_misses;
+    fprintf(out, "keyword lookups: %llu, %llu hits (%.1f%%), %llu misses\n", lookups,
+            stats->keyword_hits, percent_of(stats->keyword_hits, lookups), stats->keyword_misses);
+
+    // totals are estimated from the samples, nested sections are part of the ones around them
+    fprintf(out, "cycles (1 in %d calls sampled):\n", INSTRUMENT_SAMPLE_RATE);
+    fprintf(out, "    %-24s %12s %12s %16s\n", "section", "calls", "cycles/call", "estimated total");
+    for (int i = 0; i < InstrumentSection_COUNT; ++i)
+    {
+        InstrumentTiming *timing = &stats->timings[i];
+        if (!timing->calls) continue;
+
+        f64 per_call = timing->samples ? (f64)timing->sampled_cycles / (f64)timing->samples : 0.0;
+        fprintf(out, "    %-24s %12llu %12.1f %16.0f\n", instrument_section_names[i], timing->calls,
+                per_call, per_call * (f64)timing->calls);
+    }
+}
\ No newline at end of file
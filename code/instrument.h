@@ -0,0 +1,127 @@
+#pragma once
+
+#include "common.h"
+#include "lexer.h"
+#include "platform.h"
+
+#include <stdio.h>
+
+// @debug counters on the hot paths of the lexer, to see where the time of a run goes.
+// build with -DLEXER_INSTRUMENT=1 to turn them on. when off every INSTRUMENT_ macro expands
+// to nothing and the lexer compiles to the same code as without them
+#ifndef LEXER_INSTRUMENT
+#define LEXER_INSTRUMENT 0
+#endif
+
+// one in this many calls of a timed section reads the cycle counter, a power of two
+#define INSTRUMENT_SAMPLE_RATE 16
+
+// where the bytes of the input end up
+enum InstrumentBytes
+{
+    InstrumentBytes_WHITESPACE,
+    InstrumentBytes_COMMENT,
+    InstrumentBytes_IDENTIFIER, // keywords included
+    InstrumentBytes_NUMBER,
+    InstrumentBytes_STRING,
+    InstrumentBytes_OPERATOR,
+    InstrumentBytes_ERROR,
+
+    InstrumentBytes_COUNT
+};
+
+// parts of the lexer that are timed
+enum InstrumentSection
+{
+    InstrumentSection_WHITESPACE, // the skip_whitespace kernel
+    InstrumentSection_LINE_COMMENT,
+    InstrumentSection_BLOCK_COMMENT,
+    InstrumentSection_IDENTIFIER,
+    InstrumentSection_KEYWORD, // also part of IDENTIFIER
+    InstrumentSection_NUMBER,
+    InstrumentSection_BINARY_NUMBER,
+    InstrumentSection_HEX_NUMBER,
+    InstrumentSection_STRING,
+    InstrumentSection_OPERATOR, // scan_operator, or check_for_equals on the hand written path
+    InstrumentSection_ONE_CHARACTER, // also part of OPERATOR on the hand written path
+
+    InstrumentSection_COUNT
+};
+
+struct InstrumentTiming
+{
+    u64 calls = 0;
+    u64 samples = 0;
+    u64 sampled_cycles = 0;
+};
+
+// @note one per thread, the lexers of tokenize_parallel each count into their own.
+// the counters stay zero when LEXER_INSTRUMENT is off
+struct LexerStats
+{
+    u64 tokens[TokenType_ERROR + 1] = {};
+    u64 bytes[InstrumentBytes_COUNT] = {};
+    u64 keyword_hits = 0;
+    u64 keyword_misses = 0;
+    InstrumentTiming timings[InstrumentSection_COUNT];
+};
+
+extern thread_local LexerStats lexer_stats;
+
+void reset_lexer_stats(void);
+// prints the counters of the calling thread
+void report_lexer_stats(FILE *out);
+
+#if LEXER_INSTRUMENT
+
+inline InstrumentBytes instrument_bytes_of(TokenType type)
+{
+    if ((type == TokenType_IDENTIFIER) || ((type >= __TokenType_FIRST_KEYWORD) && (type <= __TokenType_LAST_KEYWORD)))
+    {
+        return InstrumentBytes_IDENTIFIER;
+    }
+    if (type == TokenType_NUMBER) return InstrumentBytes_NUMBER;
+    if (type == TokenType_STRING) return InstrumentBytes_STRING;
+    if (type == TokenType_ERROR) return InstrumentBytes_ERROR;
+    return InstrumentBytes_OPERATOR; // the end of file token has no bytes
+}
+
+// times its scope in one of INSTRUMENT_SAMPLE_RATE calls, nested sections are counted in both.
+// @note reading the counter takes a few dozen cycles itself, short sections look slower than they are
+struct InstrumentTimer
+{
+    InstrumentTiming *timing;
+    u64 start = 0;
+
+    InstrumentTimer(InstrumentSection section)
+    {
+        timing = &lexer_stats.timings[section];
+        timing->calls += 1;
+        if ((timing->calls & (INSTRUMENT_SAMPLE_RATE - 1)) == 0) start = get_cycle_count();
+    }
+
+    ~InstrumentTimer()
+    {
+        if (start)
+        {
+            timing->sampled_cycles += get_cycle_count() - start;
+            timing->samples += 1;
+        }
+    }
+};
+
+#define INSTRUMENT_TOKEN(token) \
+    (lexer_stats.tokens[(token)->type] += 1, \
+     lexer_stats.bytes[instrument_bytes_of((token)->type)] += (token)->source_length)
+#define INSTRUMENT_BYTES(category, count) (lexer_stats.bytes[InstrumentBytes_##category] += (u64)(count))
+#define INSTRUMENT_KEYWORD(hit) ((hit) ? (lexer_stats.keyword_hits += 1) : (lexer_stats.keyword_misses += 1))
+#define INSTRUMENT_TIME(section) InstrumentTimer instrument_timer(InstrumentSection_##section)
+
+#else
+
+#define INSTRUMENT_TOKEN(token)
+#define INSTRUMENT_BYTES(category, count)
+#define INSTRUMENT_KEYWORD(hit)
+#define INSTRUMENT_TIME(section)
+
+#endif
\ No newline at end of file
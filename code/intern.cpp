@@ -0,0 +1,89 @@
+#include "intern.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INTERN_INITIAL_SLOTS 1024
+
+static void insert_slot(InternSlot *slots, u32 slot_count, u32 hash, u32 atom)
+{
+    u32 mask = slot_count - 1;
+    u32 index = hash & mask;
+    while (slots[index].atom) index = (index + 1) & mask;
+
+    slots[index].hash = hash;
+    slots[index].atom = atom + 1;
+}
+
+static void grow_slots(InternTable *table)
+{
+    u32 new_count = table->slot_count ? table->slot_count * 2 : INTERN_INITIAL_SLOTS;
+    InternSlot *new_slots = (InternSlot*)calloc(new_count, sizeof(InternSlot));
+    assert(new_slots);
+
+    // the hashes are kept in the slots, so nothing has to be hashed again
+    for (u32 i = 0; i < table->slot_count; ++i)
+    {
+        InternSlot *slot = &table->slots[i];
+        if (slot->atom) insert_slot(new_slots, new_count, slot->hash, slot->atom - 1);
+    }
+
+    free(table->slots);
+    table->slots = new_slots;
+    table->slot_count = new_count;
+}
+
+u32 InternTable::intern(const char *data, u64 length, u32 hash)
+{
+    // keep the load below 1/2 so probe sequences stay short
+    if ((count + 1) * 2 > slot_count) grow_slots(this);
+
+    u32 mask = slot_count - 1;
+    u32 index = hash & mask;
+    while (slots[index].atom)
+    {
+        InternSlot *slot = &slots[index];
+        if (slot->hash == hash)
+        {
+            String *name = &names[slot->atom - 1];
+            if ((name->length == length) && (memcmp(name->data, data, length) == 0)) return slot->atom - 1;
+        }
+        index = (index + 1) & mask;
+    }
+
+    if (count >= allocated)
+    {
+        u32 new_allocated = allocated ? allocated * 2 : INTERN_INITIAL_SLOTS / 2;
+        String *new_names = (String*)realloc(names, new_allocated * sizeof(String));
+        assert(new_names);
+        names = new_names;
+        allocated = new_allocated;
+    }
+
+    u32 atom = count++;
+    names[atom].data = strings.copy_string(data, length);
+    names[atom].length = length;
+
+    slots[index].hash = hash;
+    slots[index].atom = atom + 1;
+    return atom;
+}
+
+String InternTable::get_name(u32 atom)
+{
+    assert(atom < count);
+    return names[atom];
+}
+
+void InternTable::release(void)
+{
+    free(slots);
+    free(names);
+    slots = null;
+    names = null;
+    slot_count = 0;
+    count = 0;
+    allocated = 0;
+    strings.release();
+}
\ No newline at end of file
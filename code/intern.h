@@ -0,0 +1,37 @@
+#pragma once
+
+#include "common.h"
+#include "arena.h"
+#include "lexer.h"
+
+// hash of identifier text, updated one byte at a time while the lexer scans (FNV-1a)
+#define INTERN_HASH_SEED (0x811c9dc5u)
+
+inline u32 intern_hash_step(u32 hash, u8 c)
+{
+    return (hash ^ c) * 0x01000193u;
+}
+
+struct InternSlot
+{
+    u32 hash = 0;
+    u32 atom = 0; // atom + 1, 0 marks an empty slot
+};
+
+// @note every unique string is stored once in 'strings' and gets a dense atom,
+// atoms and the names behind them stay valid until the table is released.
+// not thread safe, every lexer running in parallel needs its own table.
+struct InternTable
+{
+    InternSlot *slots = null;
+    u32 slot_count = 0; // power of two
+    String *names = null;
+    u32 count = 0;
+    u32 allocated = 0;
+
+    Arena strings;
+
+    u32 intern(const char *data, u64 length, u32 hash);
+    String get_name(u32 atom);
+    void release(void);
+};
\ No newline at end of file
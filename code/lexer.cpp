@@ -1,86 +1,167 @@
 #include "lexer.h"
+#include "char_class.h"
+#include "intern.h"
+#include "instrument.h"
 #include <assert.h>
 #include <stdio.h>
-#include <stdarg.h>
-#include <ctype.h>
-
-b8 strings_match(const char *a, const char *b)
-{
-    if (!a) { if (!b) return true; else return false; }
-    while (*a)
-    {
-        if (*a != *b) return false;
-        ++a;
-        ++b;
-    }
-    return !(*b);
-}
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
 
 inline b8 starts_identifier(int c)
 {
-    if (isalpha(c) || c == '_') return true;
-    return false;
+    return char_is(c, CharClass_IDENT_START);
 }
 
 inline b8 continus_identifier(int c)
 {
-    if (isalnum(c) || c == '_') return true;
-    return false;
+    return char_is(c, CharClass_IDENT_CONTINUE);
 }
 
 /////////////////////////////////////////////////////////
-b8 Lexer::initialize(String source)
+String pad_input(String source, Arena *arena)
+{
+    String result;
+    result.data = (char*)arena->allocate(source.length + LEXER_INPUT_PADDING);
+    if (!result.data) return result;
+
+    memcpy(result.data, source.data, source.length);
+    memset(result.data + source.length, 0, LEXER_INPUT_PADDING);
+    result.length = source.length;
+    return result;
+}
+
+b8 Lexer::initialize(String source, b8 is_padded)
 {
+    if (!is_padded)
+    {
+        source = pad_input(source, &input_copy);
+        if (!source.data) return false;
+    }
+
     input = source;
+    input_cursor = input.data;
+    input_end = input.data + input.length;
     current_line_number = 1;
     current_character_index = 1;
+    total_lines_processed = 0;
+    last_line_number = 0;
+    token_start = null;
+    token_cursor = 0;
+    number_of_tokens = 0;
+    tokens_eaten = 0;
+    oldest_mark = 0;
+    mark_count = 0;
+    error_count = 0;
+    decoded_strings.reset();
+    line_starts.count = 0;
     return true;
 }
 
+void Lexer::deinitialize(void)
+{
+    input_copy.release();
+    decoded_strings.release();
+    line_starts.release();
+}
+
+static_assert((TOTAL_TOKEN_COUNT & (TOTAL_TOKEN_COUNT - 1)) == 0, "the token ring has to be a power of two");
+
+// tokens behind the current one that have to stay in the ring for a mark
+inline int kept_tokens(Lexer *lexer)
+{
+    return lexer->mark_count ? (int)(lexer->tokens_eaten - lexer->oldest_mark) : 0;
+}
+
 Token *Lexer::peek_next_token(void)
 {
+    Token *slots = ring ? ring : tokens;
     if (number_of_tokens > 0)
     {
-        return &tokens[token_cursor];
+        return &slots[token_cursor];
     }
 
     generate_token();
     number_of_tokens += 1;
-    return &tokens[token_cursor];
+    return &slots[token_cursor];
 }
 
 Token *Lexer::peek_token(int index)
 {
     assert(index >= 0);
-    assert(index < TOTAL_TOKEN_COUNT);
+    assert(index + kept_tokens(this) <= ring_mask);
     if (index == 0) return peek_next_token();
 
     while (number_of_tokens <= index)
     {
-        if (should_stop_processing)
-        {
-            set_token_end(&eof);
-            return &eof;
-        }
         // generate tokens ahead
         generate_token();
         number_of_tokens += 1;
     }
-    int token_index = (token_cursor + index) % TOTAL_TOKEN_COUNT;
-    return &tokens[token_index];
+    Token *slots = ring ? ring : tokens;
+    return &slots[(token_cursor + index) & ring_mask];
 }
 
 Token *Lexer::generate_token(void)
+{
+    int errors_before = error_count;
+    Token *result = scan_token();
+    if (recover_errors && (error_count != errors_before)) recover(result);
+    result->source_offset = (u32)(token_start - input.data);
+    result->source_length = (u32)(input_cursor - token_start);
+    INSTRUMENT_TOKEN(result);
+    return result;
+}
+
+void Lexer::recover(Token *token)
+{
+    // unterminated comments only end in the end of file token
+    if (token->type == TokenType_END_OF_FILE) return;
+
+    if (token->type == TokenType_NUMBER)
+    {
+        // the makers stop at the first bad character, skip the rest of what looks
+        // like the same literal ('1.2.3', '0b102', '1.5e') so it is one error
+        while (true)
+        {
+            int c = peek_next_character();
+            if (continus_identifier(c) || ((c == '.') && (input_cursor[1] != '.'))) eat_character();
+            else break;
+        }
+    }
+    // strings already end at their closing quote or at the end of the line
+
+    token->type = TokenType_ERROR;
+    token->flags = 0;
+    token->integer_value = 0;
+    token->name.data = token_start;
+    token->name.length = input_cursor - token_start;
+    set_token_end(token);
+}
+
+Token *Lexer::scan_token(void)
 {
     while (true)
     {
         int c = peek_next_character();
-        while (isspace(c))
+        if (is_whitespace(c))
         {
+            // single separators are the common case, not worth a kernel call
             eat_character();
+            INSTRUMENT_BYTES(WHITESPACE, 1);
+            c = peek_next_character();
+        }
+        if (is_whitespace(c))
+        {
+            INSTRUMENT_TIME(WHITESPACE);
+            ScanLines lines;
+            const char *at = scan.skip_whitespace(input_cursor, &lines);
+            INSTRUMENT_BYTES(WHITESPACE, at - input_cursor);
+            skip_to(at, &lines);
             c = peek_next_character();
         }
-        if ((c == -1) || (c == 0))
+        token_start = input_cursor;
+        if (c == 0)
         {
             // end of file token
             return make_one_character_token(TokenType_END_OF_FILE);
@@ -89,7 +170,7 @@ Token *Lexer::generate_token(void)
         {
             return make_identifier();
         }
-        if (isdigit(c) != 0)
+        if (is_digit(c))
         {
             if (c == '0')
             {
@@ -105,159 +186,175 @@ Token *Lexer::generate_token(void)
                     // hex
                     return make_hex_number();
                 }
+                // the '0' is part of the decimal number's text
+                unwind_one_character();
             }
             return make_number();
         }
+        if (c == '"')
+        {
+            return make_string();
+        }
+
+        Token *result = hand_written_operators ? scan_operator_by_hand(c) : scan_operator();
+        if (result) return result;
+        // a comment was skipped
+        INSTRUMENT_BYTES(COMMENT, input_cursor - token_start);
+    }
+}
+
+// @debug what scan_operator was generated to replace, null after a comment
+Token *Lexer::scan_operator_by_hand(int c)
+{
+    if (c == '.')
+    {
+        eat_character();
+        c = peek_next_character();
         if (c == '.')
+        {
+            eat_character();
+            Token *result = make_one_character_token(TokenType_DOUBLE_DOT);
+            result->col_start -= 1;
+            return result;
+        }
+        // floating point
+        if (is_digit(c))
+        {
+            unwind_one_character();
+            return make_number();
+        }
+        
+        return make_one_character_token('.');
+    }
+
+    switch (c)
+    {
+        case '=': return check_for_equals(c, TokenType_IS_EQUAL, true);
+        case '+': return check_for_equals(c, TokenType_PLUS_EQUALS, true);
+        case '*': return check_for_equals(c, TokenType_TIMES_EQUALS, true);
+        case '%': return check_for_equals(c, TokenType_MOD_EQUALS, true);
+        case '!': return check_for_equals(c, TokenType_IS_NOT_EQUAL, true);
+
+        case '/':
         {
             eat_character();
             c = peek_next_character();
-            if (c == '.')
+            if (c == '/') // single line comment
             {
-                Token *result = make_one_character_token(TokenType_DOUBLE_DOT);
                 eat_character();
-                return result;
+                eat_until_new_line();
+                return null;
             }
-            // floating point
-            if (isdigit(c))
+            else if (c == '*') // multi line comment
             {
-                unwind_one_character();
-                return make_number();
+                eat_character();
+                eat_block_comment();
+                return null;
+            }
+            else
+            {
+                return check_for_equals('/', TokenType_DIV_EQUALS, false);
             }
-            
-            return make_one_character_token('.');
         }
 
-        switch (c)
+        case '-':
         {
-            case '=': return check_for_equals(c, TokenType_IS_EQUAL, true);
-            case '+': return check_for_equals(c, TokenType_PLUS_EQUALS, true);
-            case '*': return check_for_equals(c, TokenType_TIMES_EQUALS, true);
-            case '%': return check_for_equals(c, TokenType_MOD_EQUALS, true);
-            case '!': return check_for_equals(c, TokenType_IS_NOT_EQUAL, true);
-
-            case '/':
+            eat_character();
+            int next = peek_next_character();
+            if (next == '>')
             {
                 eat_character();
-                c = peek_next_character();
-                if (c == '/') // single line comment
-                {
-                    eat_character();
-                    eat_until_new_line();
-                    continue;
-                }
-                else if (c == '*') // multi line comment
-                {
-                    eat_character();
-                    eat_block_comment();
-                    continue;
-                }
-                else
-                {
-                    return check_for_equals('/', TokenType_DIV_EQUALS, false);
-                }
-            } break;
-
-            case '-':
+                Token *result = make_one_character_token(TokenType_RIGHT_ARROW);
+                result->col_start -= 1;
+                return result;
+            }
+            else
             {
-                eat_character();
-                int next = peek_next_character();
-                if (next == '>')
-                {
-                    // @hack: in this case we eat the character after making the token
-                    // because it's combined of two characters '->'
-                    Token *result = make_one_character_token(TokenType_RIGHT_ARROW);
-                    eat_character();
-                    return result;
-                }
-                else
-                {
-                    return check_for_equals('-', TokenType_MINUS_EQUALS, false);
-                }
-            } break;
+                return check_for_equals('-', TokenType_MINUS_EQUALS, false);
+            }
+        }
 
-            case '<':
-            {
-                eat_character();
-                int next = peek_next_character();
-                if (next == '<')
-                {   // << or <<=
-                    return check_for_equals(TokenType_SHIFT_LEFT, TokenType_SHIFT_LEFT_EQUALS, true, 1);
-                }
-                else
-                {   // < or <=
-                    return check_for_equals('<', TokenType_LESS_EQUALS, false);
-                }
-            } break;
+        case '<':
+        {
+            eat_character();
+            int next = peek_next_character();
+            if (next == '<')
+            {   // << or <<=
+                return check_for_equals(TokenType_SHIFT_LEFT, TokenType_SHIFT_LEFT_EQUALS, true, 1);
+            }
+            else
+            {   // < or <=
+                return check_for_equals('<', TokenType_LESS_EQUALS, false);
+            }
+        }
 
-            case '>':
-            {
-                eat_character();
-                int next = peek_next_character();
-                if (next == '>')
-                {   // >> or >>=
-                    return check_for_equals(TokenType_SHIFT_RIGHT, TokenType_SHIFT_RIGHT_EQUALS, true, 1);
-                }
-                else
-                {   // > or >=
-                    return check_for_equals('>', TokenType_GREATER_EQUALS, false);
-                }
-            } break;
+        case '>':
+        {
+            eat_character();
+            int next = peek_next_character();
+            if (next == '>')
+            {   // >> or >>=
+                return check_for_equals(TokenType_SHIFT_RIGHT, TokenType_SHIFT_RIGHT_EQUALS, true, 1);
+            }
+            else
+            {   // > or >=
+                return check_for_equals('>', TokenType_GREATER_EQUALS, false);
+            }
+        }
 
-            case '&':
+        case '&':
+        {
+            eat_character();
+            int next = peek_next_character();
+            if (next == '&')
             {
                 eat_character();
-                int next = peek_next_character();
-                if (next == '&')
-                {
-                    Token *result = make_one_character_token(TokenType_LOGICAL_AND);
-                    eat_character();
-                    return result;
-                }
-                else
-                {
-                    return check_for_equals('&', TokenType_BINARY_AND_EQUALS, false);
-                }
-            } break;
+                Token *result = make_one_character_token(TokenType_LOGICAL_AND);
+                result->col_start -= 1;
+                return result;
+            }
+            else
+            {
+                return check_for_equals('&', TokenType_BINARY_AND_EQUALS, false);
+            }
+        }
 
-            case '|':
+        case '|':
+        {
+            eat_character();
+            int next = peek_next_character();
+            if (next == '|')
             {
                 eat_character();
-                int next = peek_next_character();
-                if (next == '|')
-                {
-                    Token *result = make_one_character_token(TokenType_LOGICAL_OR);
-                    eat_character();
-                    return result;
-                }
-                else
-                {
-                    return check_for_equals('|', TokenType_BINARY_OR_EQUALS, false);
-                }
-            } break;
-
-            case '"': return make_string();
-
-            case '(':
-            case ')':
-            case '{':
-            case '}':
-            case '[':
-            case ']':
-            case ':':
-            case ';':
-            case ',':
-            case '#':
-            case '^': // '^' for pointers only (not used for bitwise xor operations)
-            case '~':
-            case '?':
-            case '$':
-            case '@':
-            default:
+                Token *result = make_one_character_token(TokenType_LOGICAL_OR);
+                result->col_start -= 1;
+                return result;
+            }
+            else
             {
-                eat_character();
-                return make_one_character_token(c);
-            } break;
+                return check_for_equals('|', TokenType_BINARY_OR_EQUALS, false);
+            }
+        }
+
+        case '(':
+        case ')':
+        case '{':
+        case '}':
+        case '[':
+        case ']':
+        case ':':
+        case ';':
+        case ',':
+        case '#':
+        case '^': // '^' for pointers only (not used for bitwise xor operations)
+        case '~':
+        case '?':
+        case '$':
+        case '@':
+        default:
+        {
+            eat_character();
+            return make_one_character_token(c);
         }
     }
 }
@@ -269,107 +366,158 @@ void Lexer::eat_token(void)
     assert(number_of_tokens > 0);
 
     number_of_tokens -= 1;
-    token_cursor = (token_cursor + 1) % TOTAL_TOKEN_COUNT;
+    token_cursor = (token_cursor + 1) & ring_mask;
+    tokens_eaten += 1;
+}
+
+TokenMark Lexer::mark(void)
+{
+    if (mark_count == 0) oldest_mark = tokens_eaten;
+    mark_count += 1;
+    return tokens_eaten;
+}
+
+void Lexer::rewind(TokenMark mark)
+{
+    assert(mark_count > 0);
+    assert((mark >= oldest_mark) && (mark <= tokens_eaten));
+
+    // the tokens since the mark are still in the ring, in front of the current one
+    int distance = (int)(tokens_eaten - mark);
+    token_cursor = (token_cursor - distance) & ring_mask;
+    number_of_tokens += distance;
+    tokens_eaten = mark;
+    mark_count -= 1;
+}
+
+void Lexer::drop_mark(TokenMark mark)
+{
+    assert(mark_count > 0);
+    assert((mark >= oldest_mark) && (mark <= tokens_eaten));
+    mark_count -= 1;
 }
 
 Token *Lexer::get_unused_token(void)
 {
-    assert(number_of_tokens < TOTAL_TOKEN_COUNT);
-    int index = (token_cursor + number_of_tokens) % TOTAL_TOKEN_COUNT;
-    Token *result = &tokens[index];
+    Token *result;
+    if (token_output)
+    {
+        result = token_output->add();
+    }
+    else
+    {
+        assert(number_of_tokens + kept_tokens(this) <= ring_mask);
+        Token *slots = ring ? ring : tokens;
+        result = &slots[(token_cursor + number_of_tokens) & ring_mask];
+    }
     result->type = TokenType_ERROR;
     result->line_start = current_line_number;
     result->col_start = current_character_index;
     result->flags = 0;
+    result->integer_value = 0;
+    result->name = String(); // punctuation has no name
     return result;
 }
 
 void Lexer::eat_character(void)
 {
-    if (input.data[input_cursor] == '\n')
+    if (track_positions)
     {
-        last_line_number = current_line_number;
-        ++current_line_number;
-        ++total_lines_processed;
-        current_character_index = 0;
+        if (*input_cursor == '\n')
+        {
+            last_line_number = current_line_number;
+            ++current_line_number;
+            ++total_lines_processed;
+            current_character_index = 0;
+        }
+        ++current_character_index;
     }
     ++input_cursor;
-    ++current_character_index;
 }
 
 int Lexer::peek_next_character(void)
 {
-    if (input_cursor >= input.length)
-    {
-        return -1;
-    }
-    return input.data[input_cursor];
+    // @note no bounds check, the input is followed by zero padding
+    // so the end of the input reads as 0.
+    // bytes above 127 must not come out negative
+    return (u8)*input_cursor;
 }
 
 void Lexer::unwind_one_character(void)
 {
-    assert(input_cursor != 0);
+    assert(input_cursor > input.data);
     --input_cursor;
     --current_character_index;
 }
 
 void Lexer::set_token_position(Token *token)
 {
+    if (!track_positions) return;
     token->line_start = current_line_number;
     token->col_start  = current_character_index;
 }
 
 void Lexer::set_token_end(Token *token)
 {
+    if (!track_positions) return;
     token->line_end = current_line_number;
     token->col_end  = current_character_index;
 }
 
-void Lexer::eat_until_new_line(void)
+void Lexer::skip_to(const char *target, ScanLines *lines)
 {
-    int c;
-    while (true)
+    if (track_positions)
     {
-        c = peek_next_character();
-        if (c == '\n') break;
-        if (c == -1) break;
-        if (c == 0) break;
-        eat_character();
+        if (lines->count)
+        {
+            last_line_number = current_line_number + (int)lines->count - 1;
+            current_line_number += (int)lines->count;
+            total_lines_processed += (int)lines->count;
+            current_character_index = 1 + (int)(target - lines->last_line_start);
+        }
+        else
+        {
+            current_character_index += (int)(target - input_cursor);
+        }
     }
+    input_cursor = (char*)target;
+}
+
+void Lexer::eat_until_new_line(void)
+{
+    INSTRUMENT_TIME(LINE_COMMENT);
+    ScanLines lines;
+    const char *at = scan.find_line_end(input_cursor);
+    skip_to(at, &lines);
 }
 
 void Lexer::eat_block_comment(void)
 {
-    int c;
-    while (true)
+    INSTRUMENT_TIME(BLOCK_COMMENT);
+    ScanLines lines;
+    const char *at = scan.find_block_comment_end(input_cursor, &lines);
+    while ((*at == 0) && (at < input_end))
     {
-        c = peek_next_character();
-        if (c == -1)
-        {
-            set_token_end(&eof);
-            report_error(&eof, "Reached end of file from within a comment.");
-            return;
-        }
-        // check for end of comment block
-        if (c == '*')
-        {
-            eat_character();
-            int next = peek_next_character();
-            if (next == '/')
-            {
-                eat_character();
-                break;
-            }
-        }
-        else
-        {
-            eat_character();
-        }
+        // a zero byte inside the comment, keep going
+        at = scan.find_block_comment_end(at + 1, &lines);
+    }
+    skip_to(at, &lines);
+
+    if (at >= input_end)
+    {
+        set_token_end(&eof);
+        report_error(&eof, Diagnostic_UNTERMINATED_COMMENT);
+        return;
     }
+
+    // "*/"
+    eat_character();
+    eat_character();
 }
 
 Token *Lexer::make_one_character_token(int type)
 {
+    INSTRUMENT_TIME(ONE_CHARACTER);
     Token *result = get_unused_token();
     set_token_position(result);
     result->type = (TokenType)type;
@@ -380,6 +528,7 @@ Token *Lexer::make_one_character_token(int type)
 
 Token *Lexer::check_for_equals(int token, int composed_token, b8 should_consume, int subtract_amount)
 {
+    INSTRUMENT_TIME(OPERATOR);
     Token *result;
     if (should_consume) eat_character();
 
@@ -400,45 +549,181 @@ Token *Lexer::check_for_equals(int token, int composed_token, b8 should_consume,
 
 Token *Lexer::make_identifier(void)
 {
+    INSTRUMENT_TIME(IDENTIFIER);
     Token *result = get_unused_token();
     result->type = TokenType_IDENTIFIER;
     set_token_position(result);
     
+    char *start = input_cursor;
     int c = peek_next_character();
-    char *cur = token_buffer;
-    while (continus_identifier(c))
+    if (interner)
     {
-        *cur++ = c;
-        eat_character();
-        c = peek_next_character();
+        // hash on the way, the bytes are not looked at again
+        u32 hash = INTERN_HASH_SEED;
+        while (continus_identifier(c))
+        {
+            hash = intern_hash_step(hash, (u8)c);
+            eat_character();
+            c = peek_next_character();
+        }
+
+        result->name.length = input_cursor - start;
+        result->name.data = start;
+        result->type = check_for_keyword(result);
+        if (result->type == TokenType_IDENTIFIER)
+        {
+            result->atom.id = interner->intern(start, result->name.length, hash);
+            result->atom.hash = hash;
+        }
+    }
+    else
+    {
+        while (continus_identifier(c))
+        {
+            eat_character();
+            c = peek_next_character();
+        }
+
+        result->name.length = input_cursor - start;
+        result->name.data = start;
+        result->type = check_for_keyword(result);
     }
-    *cur = 0;
-    
-    result->name.length = cur - token_buffer;
-    result->name.data = token_buffer;
-    result->type = check_for_keyword(result);
 
     set_token_end(result);
     return result;
 }
 
+/////////////////////////////////////////////////////////
+// SWAR digit parsing, 8 characters per step.
+// @note loading 8 bytes at the cursor is always fine because of the input padding,
+// the zero sentinel is not a digit so runs never extend past the input.
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+inline int lowest_bit_index64(u64 x) { unsigned long index; _BitScanForward64(&index, x); return (int)index; }
+#else
+inline int lowest_bit_index64(u64 x) { return __builtin_ctzll(x); }
+#endif
+
+#define SWAR_ONES (0x0101010101010101ull)
+#define SWAR_HIGH (0x8080808080808080ull)
+
+inline u64 load_eight_bytes(const char *at)
+{
+    u64 result;
+    memcpy(&result, at, sizeof(result));
+    return result;
+}
+
+// high bit of every byte that is in [low, high], both below 128
+inline u64 bytes_in_range(u64 x, u8 low, u8 high)
+{
+    u64 y = x & ~SWAR_HIGH; // no carries between bytes
+    u64 at_least_low = y + SWAR_ONES * (128 - low);
+    u64 above_high = y + SWAR_ONES * (127 - high);
+    return at_least_low & ~above_high & ~x & SWAR_HIGH;
+}
+
+// how many of the first bytes have their high bit set in 'mask'
+inline int leading_bytes(u64 mask)
+{
+    u64 others = ~mask & SWAR_HIGH;
+    if (!others) return 8;
+    return lowest_bit_index64(others) / 8;
+}
+
+// the first byte is the most significant digit, digits are already 0..9
+inline u64 combine_decimal_digits(u64 digits)
+{
+    digits = (digits * 10) + (digits >> 8);
+    digits = (((digits & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+              (((digits >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+    return digits;
+}
+
+static const u64 powers_of_ten[9] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+
+// value of the run of up to 8 decimal digits at 'at'
+inline u64 parse_decimal_run(const char *at, int *count)
+{
+    u64 x = load_eight_bytes(at);
+    int n = leading_bytes(bytes_in_range(x, '0', '9'));
+    *count = n;
+    if (!n) return 0;
+
+    // the digits go to the top, the bytes in front become leading zeros
+    u64 digits = (x - SWAR_ONES * '0') << (8 * (8 - n));
+    return combine_decimal_digits(digits);
+}
+
+inline u64 parse_hex_run(const char *at, int *count)
+{
+    u64 x = load_eight_bytes(at);
+    u64 is_hex = bytes_in_range(x, '0', '9') | bytes_in_range(x, 'a', 'f') | bytes_in_range(x, 'A', 'F');
+    int n = leading_bytes(is_hex);
+    *count = n;
+    if (!n) return 0;
+
+    // '0'..'9' keep their low nibble, letters have bit 6 set and need 9 more
+    u64 nibbles = (x & (SWAR_ONES * 0x0F)) + ((x >> 6) & SWAR_ONES) * 9;
+    nibbles <<= 8 * (8 - n);
+    nibbles = ((nibbles << 4) | (nibbles >> 8)) & 0x00FF00FF00FF00FFull;
+    nibbles = ((nibbles << 8) | (nibbles >> 16)) & 0x0000FFFF0000FFFFull;
+    nibbles = ((nibbles << 16) | (nibbles >> 32)) & 0x00000000FFFFFFFFull;
+    return nibbles;
+}
+
+inline u64 parse_binary_run(const char *at, int *count)
+{
+    u64 x = load_eight_bytes(at);
+    int n = leading_bytes(bytes_in_range(x, '0', '1'));
+    *count = n;
+    if (!n) return 0;
+
+    // moves the bit of byte i to bit 63 - i, the products never overlap
+    u64 bits = ((x & SWAR_ONES) << (8 * (8 - n))) * 0x8040201008040201ull;
+    return bits >> 56;
+}
+
+// @note strtod rounds correctly, it only needs the '_' separators and the 'f' postfix gone
+static f64 parse_float(const char *text, u64 length)
+{
+    if (text[length - 1] == 'f') length -= 1;
+
+    char buffer[MAX_TOKEN_SIZE];
+    char *digits = buffer;
+    if (length + 1 > sizeof(buffer)) digits = (char*)malloc(length + 1);
+
+    u64 count = 0;
+    for (u64 i = 0; i < length; ++i)
+    {
+        if (text[i] != '_') digits[count++] = text[i];
+    }
+    digits[count] = 0;
+
+    f64 result = strtod(digits, null);
+    if (digits != buffer) free(digits);
+    return result;
+}
+
 Token *Lexer::make_number(void)
 {
+    INSTRUMENT_TIME(NUMBER);
     Token *result = get_unused_token();
     result->type = TokenType_NUMBER;
     set_token_position(result);
 
-    char *mantisse_cursor = null;
-    char *exponent_cursor = null;
+    char *start = input_cursor;
+    b8 seen_decimal_point = false;
+    b8 seen_exponent = false;
+    b8 overflowed = false;
 
     u64 digital_accumulator = 0;
 
-    char *cur = token_buffer;
     int c;
     
     while (true)
     {
-        if (cur >= (token_buffer + MAX_TOKEN_SIZE)) break;
         c = peek_next_character();
 
         if (c == '_')
@@ -458,57 +743,60 @@ Token *Lexer::make_number(void)
             }
             else
             {
-                if (mantisse_cursor)
+                if (seen_decimal_point)
                 {
                     set_token_end(result);
-                    report_error(result, "Can't have two decimal points in a number");
+                    report_error(result, Diagnostic_TWO_DECIMAL_POINTS);
                     break;
                 }
 
-                *cur++ = '.';
-                mantisse_cursor = cur;
+                seen_decimal_point = true;
                 result->flags |= LiteralNumber_FLOAT;
                 continue;
             }
         }
         else
         {
-            if (mantisse_cursor)
+            if (seen_decimal_point)
             {
-                // float
-                if (!isdigit(c))
+                // float, strtod parses the text later so digits are only skipped
+                if (is_digit(c) && !scalar_numbers)
+                {
+                    int count;
+                    parse_decimal_run(input_cursor, &count);
+                    input_cursor += count;
+                    current_character_index += count;
+                    continue;
+                }
+
+                if (!is_digit(c))
                 {
                     if ((c == 'e') || (c == 'E'))
                     {
-                        if (exponent_cursor)
+                        if (seen_exponent)
                         {
                             set_token_end(result);
-                            report_error(result, "Can't have two exponents in a number");
+                            report_error(result, Diagnostic_TWO_EXPONENTS);
                             break;
                         }
 
-                        exponent_cursor = cur;
-                        *cur++ = 'e';
+                        seen_exponent = true;
 
                         eat_character();
                         c = peek_next_character();
                         if ((c == '+') || (c == '-'))
                         {
-                            if (cur < (token_buffer + MAX_TOKEN_SIZE))
-                            {
-                                *cur++ = c;
-                                eat_character();
-                            }
+                            eat_character();
                             continue;
                         }
-                        else if (isdigit(c))
+                        else if (is_digit(c))
                         {
                             continue;
                         }
                         else
                         {
                             set_token_end(result);
-                            report_error(result, "'e' in float literals must be followed by '+' or '-' or a numerical digit");
+                            report_error(result, Diagnostic_BAD_EXPONENT);
                             break;
                         }
                     }
@@ -516,7 +804,6 @@ Token *Lexer::make_number(void)
                     {
                         // literal ends with the 'f' postfix
                         eat_character();
-                        *cur++ = 'f';
                         break;
                     }
                     // exit if the character is not a digit, 'e' or 'E'
@@ -531,9 +818,23 @@ Token *Lexer::make_number(void)
                 // because we probably reached the end of the number
                 int digit = 0;
 
-                if (isdigit(c))
+                if (is_digit(c) && !scalar_numbers)
+                {
+                    int count;
+                    u64 run = parse_decimal_run(input_cursor, &count);
+                    if (digital_accumulator > (~0ull - run) / powers_of_ten[count]) overflowed = true;
+                    digital_accumulator = digital_accumulator * powers_of_ten[count] + run;
+
+                    // digits never end a line
+                    input_cursor += count;
+                    current_character_index += count;
+                    continue;
+                }
+
+                if (is_digit(c))
                 {
                     digit = c - '0';
+                    if (digital_accumulator > (~0ull - digit) / 10) overflowed = true;
                     digital_accumulator *= 10;
                     digital_accumulator += digit;
                 }
@@ -544,20 +845,32 @@ Token *Lexer::make_number(void)
             }
         }
 
-        *cur++ = c;
         eat_character();
     }
-    *cur = 0;
 
-    result->name.length = cur - token_buffer;
-    result->name.data = token_buffer;
+    result->name.length = input_cursor - start;
+    result->name.data = start;
     set_token_end(result);
-    //fprintf(stdout, "%llu\n", digital_accumulator);
+
+    if (result->flags & LiteralNumber_FLOAT)
+    {
+        result->float_value = parse_float(result->name.data, result->name.length);
+        if (result->float_value == HUGE_VAL)
+        {
+            report_error(result, Diagnostic_FLOAT_TOO_LARGE);
+        }
+    }
+    else
+    {
+        result->integer_value = digital_accumulator;
+        if (overflowed) report_error(result, Diagnostic_INTEGER_TOO_LARGE);
+    }
     return result;
 }
 
 Token *Lexer::make_binary_number(void)
 {
+    INSTRUMENT_TIME(BINARY_NUMBER);
     Token *result = get_unused_token();
     result->type = TokenType_NUMBER;
     result->flags = LiteralNumber_BINARY;
@@ -566,12 +879,12 @@ Token *Lexer::make_binary_number(void)
     eat_character();
 
     u64 digital_accumulator = 0;
+    b8 overflowed = false;
 
-    char *cur = token_buffer;
+    char *start = input_cursor;
     int c;
     while (true)
     {
-        if (cur >= (token_buffer + MAX_TOKEN_SIZE)) break;
         c = peek_next_character();
 
         if (c == '_')
@@ -592,21 +905,34 @@ Token *Lexer::make_binary_number(void)
             else
             {
                 set_token_end(result);
-                report_error(result, "Can't have a decimal point in a binary number");
+                report_error(result, Diagnostic_BINARY_DECIMAL_POINT);
                 break;
             }
         }
 
-        if (isdigit(c))
+        if (((c == '0') || (c == '1')) && !scalar_numbers)
+        {
+            int count;
+            u64 run = parse_binary_run(input_cursor, &count);
+            if (digital_accumulator >> (64 - count)) overflowed = true;
+            digital_accumulator = (digital_accumulator << count) | run;
+
+            input_cursor += count;
+            current_character_index += count;
+            continue;
+        }
+
+        if (is_digit(c))
         {
             int digit = c - '0';
             if (digit > 1)
             {
                 set_token_end(result);
-                report_error(result, "Invalid digit in a binary number");
+                report_error(result, Diagnostic_INVALID_BINARY_DIGIT);
                 break;
             }
 
+            if (digital_accumulator >> 63) overflowed = true;
             digital_accumulator *= 2;
             digital_accumulator += digit;
         }
@@ -616,19 +942,20 @@ Token *Lexer::make_binary_number(void)
         }
 
         eat_character();
-        *cur++ = c;
     }
-    *cur = 0;
 
-    result->name.length = cur - token_buffer;
-    result->name.data = token_buffer;
+    result->name.length = input_cursor - start;
+    result->name.data = start;
     set_token_end(result);
-    //fprintf(stdout, "%llu\n", digital_accumulator);
+
+    result->integer_value = digital_accumulator;
+    if (overflowed) report_error(result, Diagnostic_INTEGER_TOO_LARGE);
     return result;
 }
 
 Token *Lexer::make_hex_number(void)
 {
+    INSTRUMENT_TIME(HEX_NUMBER);
     Token *result = get_unused_token();
     result->type = TokenType_NUMBER;
     result->flags = LiteralNumber_HEXADECIMAL;
@@ -637,12 +964,12 @@ Token *Lexer::make_hex_number(void)
     eat_character();
 
     u64 digital_accumulator = 0;
+    b8 overflowed = false;
 
-    char *cur = token_buffer;
+    char *start = input_cursor;
     int c;
     while (true)
     {
-        if (cur >= (token_buffer + MAX_TOKEN_SIZE)) break;
         c = peek_next_character();
 
         if (c == '_')
@@ -663,76 +990,96 @@ Token *Lexer::make_hex_number(void)
             else
             {
                 set_token_end(result);
-                report_error(result, "Can't have a decimal point in a hexadecimal number");
+                report_error(result, Diagnostic_HEXADECIMAL_DECIMAL_POINT);
                 break;
             }
         }
 
-        int digit = 0;
-        if ((c >= 'A') && (c <= 'F'))
-        {
-            digit = 10 + (c - 'A');
-        }
-        else if ((c >= 'a') && (c <= 'f'))
-        {
-            digit = 10 + (c - 'a');
-        }
-        else if ((c >= '0') && (c <= '9'))
-        {
-            digit = c - '0';
-        }
-        else
+        if (!is_hex_digit(c)) break;
+
+        if (!scalar_numbers)
         {
-            break;
+            int count;
+            u64 run = parse_hex_run(input_cursor, &count);
+            if (digital_accumulator >> (64 - 4 * count)) overflowed = true;
+            digital_accumulator = (digital_accumulator << (4 * count)) | run;
+
+            input_cursor += count;
+            current_character_index += count;
+            continue;
         }
 
+        int digit = hex_digit_value(c);
+
+        if (digital_accumulator >> 60) overflowed = true;
         digital_accumulator *= 16;
         digital_accumulator += digit;
 
         eat_character();
-        *cur++ = c;
     }
-    *cur = 0;
 
-    result->name.length = cur - token_buffer;
-    result->name.data = token_buffer;
+    result->name.length = input_cursor - start;
+    result->name.data = start;
     set_token_end(result);
-    //fprintf(stdout, "%llu\n", digital_accumulator);
+
+    result->integer_value = digital_accumulator;
+    if (overflowed) report_error(result, Diagnostic_INTEGER_TOO_LARGE);
     return result;
 }
 
 Token *Lexer::make_string(void)
 {
+    INSTRUMENT_TIME(STRING);
     Token *result = get_unused_token();
     result->type = TokenType_STRING;
     set_token_position(result);
     eat_character();
 
-    char *cur = token_buffer;
+    // @note literals without escape sequences reference the input directly,
+    // only the ones that need decoding are copied into the string arena
+    Arena *arena = string_arena ? string_arena : &decoded_strings;
+    char *start = input_cursor;
+    char *end = start;
+    char *decoded = null;
+    char *cur = null;
+    u64 capacity = 0;
 
     while (true)
     {
+        end = input_cursor;
         int c = peek_next_character();
-        eat_character();
-
-        if (c == '"') break;
 
-        if (c == -1)
+        if ((c == 0) && (input_cursor >= input_end))
         {
             set_token_end(result);
-            report_error(result, "Reached end of file within a string literal.");
+            report_error(result, Diagnostic_UNTERMINATED_STRING);
             break;
         }
 
+        eat_character();
+
+        if (c == '"') break;
+
         if (c == '\n')
         {
             set_token_end(result);
-            report_error(result, "Reached new line within a string literal.");
+            report_error(result, Diagnostic_NEW_LINE_IN_STRING);
             break;
         }
 
         if (c == '\\')
         {
+            if (!decoded)
+            {
+                // first escape sequence, the literal can't go past the end of the line
+                // so that is enough room, the rest is given back at the end
+                u64 length = end - start;
+                capacity = (scan.find_line_end(input_cursor) - start) + 1;
+                decoded = (char*)arena->allocate(capacity);
+                memcpy(decoded, start, length);
+                cur = decoded + length;
+            }
+
             int next = peek_next_character();
             if (next == 'a')
             {
@@ -755,7 +1102,7 @@ Token *Lexer::make_string(void)
                         if (c > 255)
                         {
                             set_token_end(result);
-                            report_error(result, "Decimal value of '%d' exceeds the limit.", c);
+                            report_error(result, Diagnostic_DECIMAL_ESCAPE_TOO_LARGE, c);
                         }
                     }
                 }
@@ -828,23 +1175,45 @@ Token *Lexer::make_string(void)
             else
             {
                 set_token_end(result);
-                report_error(result, "Unknown escape sequence '\\%c' in string literal.", next);
+                report_error(result, Diagnostic_UNKNOWN_ESCAPE, next);
                 c = next;
                 eat_character();
             }
         }
 
-        *cur++ = c;
+        if (decoded)
+        {
+            if (cur + 1 >= decoded + capacity)
+            {
+                // zero bytes inside the literal hide the end of the line, grow.
+                // the old reservation is still the last one, give it back first so the
+                // grown one starts at the same place when the block has room
+                u64 length = cur - decoded;
+                arena->shrink_last(decoded, capacity, 0);
+                char *grown = (char*)arena->allocate(capacity * 2);
+                memmove(grown, decoded, length);
+                decoded = grown;
+                cur = decoded + length;
+                capacity *= 2;
+            }
+            *cur++ = c;
+        }
     }
     
-    *cur = 0;
-    
-    result->name.length = cur - token_buffer;
-    if (result->name.length)
+    if (decoded)
     {
-        result->name.data = token_buffer;
+        *cur = 0;
+        result->name.length = cur - decoded;
+        result->name.data = decoded;
+        arena->shrink_last(decoded, capacity, result->name.length + 1);
     }
     else
+    {
+        result->name.length = end - start;
+        result->name.data = start;
+    }
+
+    if (!result->name.length)
     {
         // empty string
         result->name.data = null;
@@ -857,13 +1226,13 @@ int Lexer::parse_decimal_digit(void)
 {
     int c = peek_next_character();
 
-    if (c >= '0' && c <= '9')
+    if (is_digit(c))
     {
         eat_character();
         return c - '0';
     }
 
-    report_error(&eof, "Invalid decimal digit.\n\\d must be followed by 3 decimal digits.");
+    report_error(&eof, Diagnostic_INVALID_DECIMAL_ESCAPE);
     return -1;
 }
 
@@ -871,129 +1240,670 @@ int Lexer::parse_hexadecimal_digit(void)
 {
     int c = peek_next_character();
 
-    if (c >= '0' && c <= '9')
+    if (is_hex_digit(c))
     {
         eat_character();
-        return c - '0';
+        return hex_digit_value(c);
     }
-    else if (c >= 'A' && c <= 'F')
+
+    report_error(&eof, Diagnostic_INVALID_HEXADECIMAL_ESCAPE);
+    return -1;
+}
+
+struct KeywordSpec
+{
+    const char *name;
+    TokenType type;
+};
+
+static constexpr KeywordSpec keyword_specs[] = {
+    {"as", TokenType_KEYWORD_AS},
+    {"if", TokenType_KEYWORD_IF},
+    {"or", TokenType_LOGICAL_OR},
+    {"for", TokenType_KEYWORD_FOR},
+    {"and", TokenType_LOGICAL_AND},
+    {"xor", TokenType_BINARY_XOR},
+    {"case", TokenType_KEYWORD_CASE},
+    {"cast", TokenType_KEYWORD_CAST},
+    {"else", TokenType_KEYWORD_ELSE},
+    {"enum", TokenType_KEYWORD_ENUM},
+    {"null", TokenType_KEYWORD_NULL},
+    {"then", TokenType_KEYWORD_THEN},
+    {"true", TokenType_KEYWORD_TRUE},
+    {"type", TokenType_KEYWORD_TYPE},
+    {"with", TokenType_KEYWORD_WITH},
+    {"alias", TokenType_KEYWORD_ALIAS},
+    {"break", TokenType_KEYWORD_BREAK},
+    {"const", TokenType_KEYWORD_CONST},
+    {"defer", TokenType_KEYWORD_DEFER},
+    {"false", TokenType_KEYWORD_FALSE},
+    {"union", TokenType_KEYWORD_UNION},
+    {"using", TokenType_KEYWORD_USING},
+    {"while", TokenType_KEYWORD_WHILE},
+    {"extern", TokenType_KEYWORD_EXTERN},
+    {"inline", TokenType_KEYWORD_INLINE},
+    {"return", TokenType_KEYWORD_RETURN},
+    {"struct", TokenType_KEYWORD_STRUCT},
+    {"switch", TokenType_KEYWORD_SWITCH},
+    {"size_of", TokenType_KEYWORD_SIZE_OF},
+    {"continue", TokenType_KEYWORD_CONTINUE},
+    {"function", TokenType_KEYWORD_FUNCTION},
+    {"operator", TokenType_KEYWORD_OPERATOR},
+    {"auto_cast", TokenType_KEYWORD_AUTO_CAST},
+    {"no_inline", TokenType_KEYWORD_NO_INLINE},
+    {"undefined", TokenType_KEYWORD_UNDEFINED},
+    // reserved types
+    {"s8", TokenType_RESERVED_TYPE},
+    {"u8", TokenType_RESERVED_TYPE},
+    {"int", TokenType_RESERVED_TYPE},
+    {"s16", TokenType_RESERVED_TYPE},
+    {"s32", TokenType_RESERVED_TYPE},
+    {"s64", TokenType_RESERVED_TYPE},
+    {"u16", TokenType_RESERVED_TYPE},
+    {"u32", TokenType_RESERVED_TYPE},
+    {"u64", TokenType_RESERVED_TYPE},
+    {"f32", TokenType_RESERVED_TYPE},
+    {"f64", TokenType_RESERVED_TYPE},
+    {"bool", TokenType_RESERVED_TYPE},
+    {"void", TokenType_RESERVED_TYPE},
+    {"float", TokenType_RESERVED_TYPE},
+    {"string", TokenType_RESERVED_TYPE},
+};
+
+#define KEYWORD_MIN_LENGTH 2
+#define KEYWORD_MAX_LENGTH 9
+#define KEYWORD_TABLE_BITS 7
+#define KEYWORD_TABLE_SIZE (1 << KEYWORD_TABLE_BITS)
+// @note found by searching random odd seeds until the keyword set had no collisions,
+// if a keyword is added and the static_assert below fires, search for a new one
+#define KEYWORD_HASH_SEED 0x2daaf9b64e614f29ull
+
+// keyword bytes are compared as two little endian words, zero padded after the length
+struct KeywordEntry
+{
+    u64 word0 = 0;
+    u64 word1 = 0;
+    u64 length = 0;
+    TokenType type = TokenType_IDENTIFIER;
+};
+
+struct KeywordTable
+{
+    KeywordEntry entries[KEYWORD_TABLE_SIZE];
+    b8 has_collisions = false;
+};
+
+constexpr u64 byte_mask(u64 count)
+{
+    return (count >= 8) ? ~0ull : ((1ull << (count * 8)) - 1);
+}
+
+constexpr u64 keyword_hash(u64 word0, u64 length)
+{
+    return ((word0 ^ length) * KEYWORD_HASH_SEED) >> (64 - KEYWORD_TABLE_BITS);
+}
+
+constexpr KeywordTable make_keyword_table(void)
+{
+    KeywordTable result;
+    for (const KeywordSpec &spec : keyword_specs)
     {
-        eat_character();
-        return 10 + (c - 'A');
+        KeywordEntry entry;
+        while (spec.name[entry.length]) entry.length += 1;
+        for (u64 i = 0; i < entry.length; ++i)
+        {
+            u64 byte = (u8)spec.name[i];
+            if (i < 8) entry.word0 |= byte << (i * 8);
+            else       entry.word1 |= byte << ((i - 8) * 8);
+        }
+        entry.type = spec.type;
+
+        KeywordEntry &slot = result.entries[keyword_hash(entry.word0, entry.length)];
+        if (slot.length) result.has_collisions = true;
+        slot = entry;
     }
-    else if (c >= 'a' && c <= 'f')
+    return result;
+}
+
+static constexpr KeywordTable keyword_table = make_keyword_table();
+static_assert(!keyword_table.has_collisions, "keyword hash has collisions, pick a new KEYWORD_HASH_SEED");
+
+TokenType Lexer::check_for_keyword(Token *token)
+{
+    INSTRUMENT_TIME(KEYWORD);
+    String name = token->name;
+    u64 length = name.length;
+    if ((length < KEYWORD_MIN_LENGTH) || (length > KEYWORD_MAX_LENGTH))
     {
-        eat_character();
-        return 10 + (c - 'a');
+        INSTRUMENT_KEYWORD(false);
+        return TokenType_IDENTIFIER;
     }
 
-    report_error(&eof, "Invalid hexadecimal digit.\n\\x must be followed by 2 hexadecimal digits.");
-    return -1;
+    // identifiers are never decoded, so the padding after the input covers the load
+    u64 words[2];
+    memcpy(words, name.data, 16);
+    u64 word0 = words[0] & byte_mask(length);
+    u64 word1 = (length > 8) ? (words[1] & byte_mask(length - 8)) : 0;
+
+    const KeywordEntry &entry = keyword_table.entries[keyword_hash(word0, length)];
+    if ((entry.length == length) && (entry.word0 == word0) && (entry.word1 == word1))
+    {
+        INSTRUMENT_KEYWORD(true);
+        return entry.type;
+    }
+    INSTRUMENT_KEYWORD(false);
+    return TokenType_IDENTIFIER;
 }
 
-TokenType Lexer::check_for_keyword(Token *token)
+/////////////////////////////////////////////////////////
+// operators and the starts of comments are matched by a DFA over classes of bytes that
+// make_operator_dfa generates from operator_specs at compile time, scan_operator uses it
+// through a table of its matches for every prefix.
+// @note every prefix of an operator is a token itself (any single character is one), so
+// the longest match ends where the DFA dies and it never has to back up
+
+// what reaching a state means, token types above 255 stand for themselves
+enum OperatorAccept
 {
-    char *name = token->name.data;
-    u64 length = token->name.length;
+    OperatorAccept_NONE = 0, // the dead and the start state
+    OperatorAccept_SELF, // a single character token, its type is the character
+    OperatorAccept_LINE_COMMENT,
+    OperatorAccept_BLOCK_COMMENT,
+};
 
-    switch (length)
+struct OperatorSpec
+{
+    const char *text;
+    int accept;
+};
+
+// the tokens of TokenType that are more than one character
+static constexpr OperatorSpec operator_specs[] = {
+    {"+=", TokenType_PLUS_EQUALS},
+    {"-=", TokenType_MINUS_EQUALS},
+    {"*=", TokenType_TIMES_EQUALS},
+    {"/=", TokenType_DIV_EQUALS},
+    {"%=", TokenType_MOD_EQUALS},
+    {"==", TokenType_IS_EQUAL},
+    {"!=", TokenType_IS_NOT_EQUAL},
+    {"<=", TokenType_LESS_EQUALS},
+    {">=", TokenType_GREATER_EQUALS},
+    {"&&", TokenType_LOGICAL_AND},
+    {"||", TokenType_LOGICAL_OR},
+    {"&=", TokenType_BINARY_AND_EQUALS},
+    {"|=", TokenType_BINARY_OR_EQUALS},
+    {"<<", TokenType_SHIFT_LEFT},
+    {">>", TokenType_SHIFT_RIGHT},
+    {"<<=", TokenType_SHIFT_LEFT_EQUALS},
+    {">>=", TokenType_SHIFT_RIGHT_EQUALS},
+    {"..", TokenType_DOUBLE_DOT},
+    {"->", TokenType_RIGHT_ARROW},
+    // comments
+    {"//", OperatorAccept_LINE_COMMENT},
+    {"/*", OperatorAccept_BLOCK_COMMENT},
+};
+
+#define OPERATOR_DFA_MAX_STATES  64
+#define OPERATOR_DFA_MAX_CLASSES 32
+// no operator is longer, scan_operator looks at this many bytes at once
+#define OPERATOR_MAX_LENGTH 3
+#define OPERATOR_DFA_DEAD  0
+#define OPERATOR_DFA_START 1
+
+struct OperatorDfa
+{
+    u8 byte_class[256];
+    u8 next[OPERATOR_DFA_MAX_STATES][OPERATOR_DFA_MAX_CLASSES];
+    u16 accept[OPERATOR_DFA_MAX_STATES];
+    int state_count;
+    int class_count;
+
+    b8 missing_token; // a multi character TokenType has no spec
+    b8 needs_backtracking; // an operator has a prefix that is no token
+    b8 too_large;
+    int max_length; // of the specs
+};
+
+// the trie of the specs, one transition per byte
+struct OperatorTrie
+{
+    u8 next[OPERATOR_DFA_MAX_STATES][256];
+    u16 accept[OPERATOR_DFA_MAX_STATES];
+    b8 merged[OPERATOR_DFA_MAX_STATES];
+    int count;
+};
+
+constexpr b8 operator_states_match(const OperatorTrie &trie, int a, int b)
+{
+    if (trie.accept[a] != trie.accept[b]) return false;
+    for (int c = 0; c < 256; ++c)
     {
-        case 2:
-        {
-            if (strings_match(name, "as")) return TokenType_KEYWORD_AS;
-            if (strings_match(name, "if")) return TokenType_KEYWORD_IF;
-            if (strings_match(name, "or")) return TokenType_LOGICAL_OR;
-            // reserved types
-            if (strings_match(name, "s8")) return TokenType_RESERVED_TYPE;
-            if (strings_match(name, "u8")) return TokenType_RESERVED_TYPE;
-        } break;
-        case 3:
-        {
-            if (strings_match(name, "for")) return TokenType_KEYWORD_FOR;
-            if (strings_match(name, "and")) return TokenType_LOGICAL_AND;
-            if (strings_match(name, "xor")) return TokenType_BINARY_XOR;
-            // reserved types
-            if (strings_match(name, "int")) return TokenType_RESERVED_TYPE;
-            if (strings_match(name, "s16")) return TokenType_RESERVED_TYPE;
-            if (strings_match(name, "s32")) return TokenType_RESERVED_TYPE;
-            if (strings_match(name, "s64")) return TokenType_RESERVED_TYPE;
-            if (strings_match(name, "u16")) return TokenType_RESERVED_TYPE;
-            if (strings_match(name, "u32")) return TokenType_RESERVED_TYPE;
-            if (strings_match(name, "u64")) return TokenType_RESERVED_TYPE;
-            if (strings_match(name, "f32")) return TokenType_RESERVED_TYPE;
-            if (strings_match(name, "f64")) return TokenType_RESERVED_TYPE;
-        } break;
-        case 4:
+        if (trie.next[a][c] != trie.next[b][c]) return false;
+    }
+    return true;
+}
+
+constexpr OperatorDfa make_operator_dfa(void)
+{
+    OperatorDfa result = {};
+
+    for (int type = TokenType_PLUS_EQUALS; type <= TokenType_RIGHT_ARROW; ++type)
+    {
+        // xor is a keyword
+        if (type == TokenType_BINARY_XOR) continue;
+        b8 found = false;
+        for (const OperatorSpec &spec : operator_specs) found = found || (spec.accept == type);
+        if (!found) result.missing_token = true;
+    }
+
+    // every byte scan_token sends here is at least a single character token, they all start
+    // out in one shared state that is split off for the first bytes of operators.
+    // the end of the input is never sent
+    OperatorTrie trie = {};
+    const int single = 2;
+    trie.accept[single] = OperatorAccept_SELF;
+    trie.count = 3;
+    for (int c = 1; c < 256; ++c) trie.next[OPERATOR_DFA_START][c] = single;
+
+    for (const OperatorSpec &spec : operator_specs)
+    {
+        int state = OPERATOR_DFA_START;
+        for (int i = 0; spec.text[i]; ++i)
         {
-            if (strings_match(name, "case")) return TokenType_KEYWORD_CASE;
-            if (strings_match(name, "cast")) return TokenType_KEYWORD_CAST;
-            if (strings_match(name, "else")) return TokenType_KEYWORD_ELSE;
-            if (strings_match(name, "enum")) return TokenType_KEYWORD_ENUM;
-            if (strings_match(name, "null")) return TokenType_KEYWORD_NULL;
-            if (strings_match(name, "then")) return TokenType_KEYWORD_THEN;
-            if (strings_match(name, "true")) return TokenType_KEYWORD_TRUE;
-            if (strings_match(name, "type")) return TokenType_KEYWORD_TYPE;
-            if (strings_match(name, "with")) return TokenType_KEYWORD_WITH;
-            // reserved types
-            if (strings_match(name, "bool")) return TokenType_RESERVED_TYPE;
-            if (strings_match(name, "void")) return TokenType_RESERVED_TYPE;
-        } break;
-        case 5:
+            u8 c = (u8)spec.text[i];
+            int next = trie.next[state][c];
+            if ((next == OPERATOR_DFA_DEAD) || (next == single))
+            {
+                if (trie.count == OPERATOR_DFA_MAX_STATES)
+                {
+                    result.too_large = true;
+                    return result;
+                }
+                next = trie.count++;
+                if (state == OPERATOR_DFA_START) trie.accept[next] = OperatorAccept_SELF;
+                trie.next[state][c] = (u8)next;
+            }
+            state = next;
+            if (i + 1 > result.max_length) result.max_length = i + 1;
+        }
+        trie.accept[state] = (u16)spec.accept;
+    }
+    for (int state = OPERATOR_DFA_START + 1; state < trie.count; ++state)
+    {
+        if (trie.accept[state] == OperatorAccept_NONE) result.needs_backtracking = true;
+    }
+
+    // states with the same meaning and the same transitions are one state, merged until
+    // no two are left alike (the leaves first, then what only leads to them)
+    b8 changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int a = OPERATOR_DFA_START + 1; a < trie.count; ++a)
         {
-            if (strings_match(name, "alias")) return TokenType_KEYWORD_ALIAS;
-            if (strings_match(name, "break")) return TokenType_KEYWORD_BREAK;
-            if (strings_match(name, "const")) return TokenType_KEYWORD_CONST;
-            if (strings_match(name, "defer")) return TokenType_KEYWORD_DEFER;
-            if (strings_match(name, "false")) return TokenType_KEYWORD_FALSE;
-            if (strings_match(name, "union")) return TokenType_KEYWORD_UNION;
-            if (strings_match(name, "using")) return TokenType_KEYWORD_USING;
-            if (strings_match(name, "while")) return TokenType_KEYWORD_WHILE;
-            // reserved types
-            if (strings_match(name, "float")) return TokenType_RESERVED_TYPE;
-        } break;
-        case 6:
+            if (trie.merged[a]) continue;
+            for (int b = a + 1; b < trie.count; ++b)
+            {
+                if (trie.merged[b] || !operator_states_match(trie, a, b)) continue;
+
+                trie.merged[b] = true;
+                for (int state = 0; state < trie.count; ++state)
+                {
+                    for (int c = 0; c < 256; ++c)
+                    {
+                        if (trie.next[state][c] == b) trie.next[state][c] = (u8)a;
+                    }
+                }
+                changed = true;
+            }
+        }
+    }
+
+    u8 state_ids[OPERATOR_DFA_MAX_STATES] = {};
+    for (int state = 0; state < trie.count; ++state)
+    {
+        if (trie.merged[state]) continue;
+        state_ids[state] = (u8)result.state_count;
+        result.accept[result.state_count] = trie.accept[state];
+        result.state_count += 1;
+    }
+
+    // bytes that lead to the same state from every state are one class
+    int class_bytes[OPERATOR_DFA_MAX_CLASSES] = {};
+    for (int c = 0; c < 256; ++c)
+    {
+        int byte_class = 0;
+        for (; byte_class < result.class_count; ++byte_class)
         {
-            if (strings_match(name, "extern")) return TokenType_KEYWORD_EXTERN;
-            if (strings_match(name, "inline")) return TokenType_KEYWORD_INLINE;
-            if (strings_match(name, "return")) return TokenType_KEYWORD_RETURN;
-            if (strings_match(name, "struct")) return TokenType_KEYWORD_STRUCT;
-            if (strings_match(name, "switch")) return TokenType_KEYWORD_SWITCH;
-            // reserved types
-            if (strings_match(name, "string")) return TokenType_RESERVED_TYPE;
-        } break;
-        case 7:
+            b8 same = true;
+            for (int state = 0; same && (state < trie.count); ++state)
+            {
+                same = trie.next[state][c] == trie.next[state][class_bytes[byte_class]];
+            }
+            if (same) break;
+        }
+        if (byte_class == result.class_count)
         {
-            if (strings_match(name, "size_of")) return TokenType_KEYWORD_SIZE_OF;
-        } break;
-        case 8:
+            if (result.class_count == OPERATOR_DFA_MAX_CLASSES)
+            {
+                result.too_large = true;
+                return result;
+            }
+            class_bytes[result.class_count++] = c;
+        }
+        result.byte_class[c] = (u8)byte_class;
+    }
+
+    for (int state = 0; state < trie.count; ++state)
+    {
+        if (trie.merged[state]) continue;
+        for (int byte_class = 0; byte_class < result.class_count; ++byte_class)
         {
-            if (strings_match(name, "continue")) return TokenType_KEYWORD_CONTINUE;
-            if (strings_match(name, "function")) return TokenType_KEYWORD_FUNCTION;
-            if (strings_match(name, "operator")) return TokenType_KEYWORD_OPERATOR;
-        } break;
-        case 9:
+            result.next[state_ids[state]][byte_class] = state_ids[trie.next[state][class_bytes[byte_class]]];
+        }
+    }
+    return result;
+}
+
+static constexpr OperatorDfa operator_dfa = make_operator_dfa();
+static_assert(!operator_dfa.missing_token, "a multi character token has no entry in operator_specs");
+static_assert(!operator_dfa.needs_backtracking, "every prefix of an operator has to be a token");
+static_assert(!operator_dfa.too_large, "the operator DFA does not fit, raise OPERATOR_DFA_MAX_STATES or _CLASSES");
+static_assert(operator_dfa.max_length <= OPERATOR_MAX_LENGTH, "an operator is longer than OPERATOR_MAX_LENGTH");
+static_assert(TokenType_ERROR < (1 << 14), "token types do not fit an operator prefix entry");
+
+// the DFA run over every combination of OPERATOR_MAX_LENGTH byte classes, so scan_operator
+// finds an operator with one lookup instead of a loop over its bytes.
+// an entry is the accept of the state the DFA stopped in << 2 | the length of the match
+static constexpr int operator_class_count = operator_dfa.class_count;
+
+struct OperatorPrefixTable
+{
+    u16 entries[operator_class_count * operator_class_count * operator_class_count];
+};
+
+constexpr OperatorPrefixTable make_operator_prefix_table(void)
+{
+    OperatorPrefixTable result = {};
+    const int n = operator_class_count;
+    for (int index = 0; index < n * n * n; ++index)
+    {
+        int classes[OPERATOR_MAX_LENGTH] = { index / (n * n), (index / n) % n, index % n };
+        int state = OPERATOR_DFA_START;
+        int length = 0;
+        for (; length < OPERATOR_MAX_LENGTH; ++length)
         {
-            if (strings_match(name, "auto_cast")) return TokenType_KEYWORD_AUTO_CAST;
-            if (strings_match(name, "no_inline")) return TokenType_KEYWORD_NO_INLINE;
-            if (strings_match(name, "undefined")) return TokenType_KEYWORD_UNDEFINED;
-        } break;
+            int next = operator_dfa.next[state][classes[length]];
+            if (next == OPERATOR_DFA_DEAD) break;
+            state = next;
+        }
+        result.entries[index] = (u16)((operator_dfa.accept[state] << 2) | length);
     }
+    return result;
+}
 
-    return TokenType_IDENTIFIER;
+static constexpr OperatorPrefixTable operator_prefix_table = make_operator_prefix_table();
+
+// null after a comment
+Token *Lexer::scan_operator(void)
+{
+    // ".5" is a number
+    if ((input_cursor[0] == '.') && is_digit((u8)input_cursor[1])) return make_number();
+
+    INSTRUMENT_TIME(OPERATOR);
+    // the padding after the input covers the load, the fourth byte is not needed
+    u32 word;
+    memcpy(&word, input_cursor, 4);
+    const int n = operator_class_count;
+    int index = (operator_dfa.byte_class[word & 0xFF] * n + operator_dfa.byte_class[(word >> 8) & 0xFF]) * n +
+                operator_dfa.byte_class[(word >> 16) & 0xFF];
+    int entry = operator_prefix_table.entries[index];
+    const char *at = input_cursor + (entry & 3);
+
+    // operators never span lines
+    ScanLines lines;
+    int accept = entry >> 2;
+    if (accept == OperatorAccept_LINE_COMMENT)
+    {
+        skip_to(at, &lines);
+        eat_until_new_line();
+        return null;
+    }
+    if (accept == OperatorAccept_BLOCK_COMMENT)
+    {
+        skip_to(at, &lines);
+        eat_block_comment();
+        return null;
+    }
+
+    Token *result = get_unused_token();
+    result->type = (accept == OperatorAccept_SELF) ? (TokenType)(u8)*input_cursor : (TokenType)accept;
+    skip_to(at, &lines);
+    set_token_end(result);
+    return result;
+}
+
+/////////////////////////////////////////////////////////
+void TokenArray::reserve(s64 wanted)
+{
+    if (wanted <= allocated) return;
+
+    s64 new_allocated = allocated ? allocated * 2 : 64;
+    if (new_allocated < wanted) new_allocated = wanted;
+
+    Token *new_data = (Token*)realloc(data, new_allocated * sizeof(Token));
+    assert(new_data);
+    data = new_data;
+    allocated = new_allocated;
+}
+
+Token *TokenArray::add(void)
+{
+    if (count >= allocated) reserve(count + 1);
+    return &data[count++];
+}
+
+void TokenArray::release(void)
+{
+    free(data);
+    data = null;
+    count = 0;
+    allocated = 0;
+    strings.release();
+    unused_string_bytes = 0;
 }
 
-void Lexer::report_error(Token *pos, const char *format, ...)
+// @note average token plus the whitespace around it in our sources
+#define ESTIMATED_BYTES_PER_TOKEN 4
+
+b8 tokenize_all(String source, TokenArray *out, b8 is_padded, Diagnostics *diagnostics)
 {
-    should_stop_processing = true;
+    // offsets are stored as u32
+    if (source.length > 0xFFFFFFFF) return false;
+
+    // the copy has to live as long as the token names pointing into it
+    if (!is_padded) source = pad_input(source, &out->strings);
+    if (!source.data) return false;
 
-    fprintf(stderr, "<filename>:%d:%d: Error: ", pos->line_start, pos->col_start);
+    Lexer lexer;
+    if (!lexer.initialize(source, true)) return false;
+    lexer.diagnostics = diagnostics;
+    return lexer.tokenize(out);
+}
+
+b8 Lexer::tokenize(TokenArray *out)
+{
+    out->reserve(out->count + (s64)(input.length / ESTIMATED_BYTES_PER_TOKEN) + 1);
 
-    va_list args;
-    va_start(args, format);
-    vfprintf(stderr, format, args);
-    va_end(args);
+    // decoded literals have to live as long as the array
+    TokenArray *previous_output = token_output;
+    Arena *previous_arena = string_arena;
+    token_output = out;
+    string_arena = &out->strings;
+    while (true)
+    {
+        Token *dest = generate_token();
+        if (dest->type == TokenType_END_OF_FILE) break;
+    }
+    token_output = previous_output;
+    string_arena = previous_arena;
+
+    return !error_count;
+}
+
+void Lexer::resolve_position(u32 offset, int *line, int *col)
+{
+    if (!line_starts.count) line_starts.build(input);
+    line_starts.resolve(offset, line, col);
+}
+
+/////////////////////////////////////////////////////////
+void LineTable::build(String source)
+{
+    // counting first costs one more pass over the input but the table is allocated
+    // exactly once, and the second pass is just as fast
+    s64 wanted = 1 + (s64)scan.count_new_lines(source.data, source.length);
+    if (wanted > allocated)
+    {
+        free(starts);
+        allocated = wanted;
+        starts = (u32*)malloc(allocated * sizeof(u32));
+    }
+
+    starts[0] = 0;
+    u32 *end = scan.find_line_starts(source.data, source.length, 0, starts + 1);
+    count = end - starts;
+    assert(count == wanted);
+}
+
+void LineTable::resolve(u32 offset, int *line, int *col)
+{
+    assert(count > 0);
+
+    // last line start that is <= offset
+    s64 low = 0;
+    s64 high = count - 1;
+    while (low < high)
+    {
+        s64 middle = (low + high + 1) / 2;
+        if (starts[middle] <= offset) low = middle;
+        else high = middle - 1;
+    }
+
+    *line = (int)low + 1;
+    *col  = (int)(offset - starts[low]) + 1;
+}
+
+void LineTable::release(void)
+{
+    free(starts);
+    starts = null;
+    count = 0;
+    allocated = 0;
+}
+
+/////////////////////////////////////////////////////////
+void TokenStore::add(TokenType type, u32 offset, u32 length)
+{
+    if (count >= allocated)
+    {
+        allocated = allocated ? allocated * 2 : 1024;
+        types   = (u16*)realloc(types,   allocated * sizeof(u16));
+        offsets = (u32*)realloc(offsets, allocated * sizeof(u32));
+        lengths = (u32*)realloc(lengths, allocated * sizeof(u32));
+    }
+
+    types[count]   = (u16)type;
+    offsets[count] = offset;
+    lengths[count] = length;
+    count += 1;
+}
+
+Token TokenStore::get_token(s64 index)
+{
+    assert((index >= 0) && (index < count));
+
+    // the line table is only built once positions are asked for
+    if (!lines.count) lines.build(source);
+
+    Token result;
+    result.type = (TokenType)types[index];
+    result.name.data   = source.data + offsets[index];
+    result.name.length = lengths[index];
+    result.source_offset = offsets[index];
+    result.source_length = lengths[index];
+
+    lines.resolve(offsets[index], &result.line_start, &result.col_start);
+    lines.resolve(offsets[index] + lengths[index], &result.line_end, &result.col_end);
+    return result;
+}
+
+u64 TokenStore::memory_size(void)
+{
+    return allocated * (sizeof(u16) + sizeof(u32) + sizeof(u32)) + lines.allocated * sizeof(u32);
+}
+
+void TokenStore::release(void)
+{
+    free(types);
+    free(offsets);
+    free(lengths);
+    types = null;
+    offsets = null;
+    lengths = null;
+    count = 0;
+    allocated = 0;
+    lines.release();
+}
+
+b8 build_token_store(String source, TokenStore *out, b8 is_padded)
+{
+    // offsets are stored as u32
+    assert(source.length <= 0xFFFFFFFF);
+
+    Lexer lexer;
+    if (!lexer.initialize(source, is_padded)) return false;
+
+    out->source = source;
+    while (true)
+    {
+        // the ring is never filled, so every token lands in the same slot
+        Token *token = lexer.generate_token();
+        out->add(token->type, token->source_offset, token->source_length);
+        if (token->type == TokenType_END_OF_FILE) break;
+    }
+
+    b8 result = !lexer.error_count;
+    lexer.deinitialize();
+    return result;
+}
+
+void Lexer::report_error(Token *pos, DiagnosticCode code, s64 argument)
+{
+    error_count += 1;
+    if (!diagnostics) return;
+
+    Diagnostic *diagnostic = diagnostics->add();
+    diagnostic->code = code;
+    diagnostic->file_id = file_id;
+    diagnostic->argument = argument;
+
+    if (pos == &eof)
+    {
+        // not tied to a token, point at where the lexer is
+        diagnostic->offset = (u32)(input_cursor - input.data);
+        diagnostic->line = current_line_number;
+        diagnostic->column = current_character_index;
+    }
+    else
+    {
+        diagnostic->offset = (u32)(token_start - input.data);
+        diagnostic->length = (u32)(input_cursor - token_start);
+        diagnostic->line = pos->line_start;
+        diagnostic->column = pos->col_start;
+    }
 
-    fputc('\n', stderr);
+    if (!track_positions) resolve_position(diagnostic->offset, &diagnostic->line, &diagnostic->column);
 }
 
 // @debug
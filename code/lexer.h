@@ -1,9 +1,14 @@
 #pragma once
 
 #include "common.h"
+#include "arena.h"
+#include "scan.h"
+#include "diagnostics.h"
 
 #define MAX_TOKEN_SIZE 512
-#define TOTAL_TOKEN_COUNT 8
+#define TOTAL_TOKEN_COUNT 8 // tokens in the ring of a plain Lexer, a power of two
+// zero bytes the lexer needs after its input, inputs from map_file have them
+#define LEXER_INPUT_PADDING 64
 
 struct String
 {
@@ -98,9 +103,17 @@ enum TokenType
     TokenType_ERROR
 };
 
+struct Atom
+{
+    u32 id;
+    u32 hash;
+};
+
 struct Token
 {
     TokenType type = TokenType_ERROR;
+    // @note name is a view into the lexer input, except for string literals
+    // with escape sequences which are decoded into the lexer's string arena
     String name;
 
     int line_start = 0;
@@ -109,32 +122,129 @@ struct Token
     int col_end    = 0;
 
     int flags = 0;
+
+    // value of a TokenType_NUMBER, float_value when flags has LiteralNumber_FLOAT.
+    // atom of a TokenType_IDENTIFIER when the lexer has an InternTable
+    union
+    {
+        u64 integer_value = 0;
+        f64 float_value;
+        Atom atom;
+    };
+
+    // byte range of the whole token in the input
+    u32 source_offset = 0;
+    u32 source_length = 0;
 };
 
+// flat token storage filled by tokenize_all
+struct TokenArray
+{
+    Token *data = null;
+    s64 count = 0;
+    s64 allocated = 0;
+
+    // decoded payloads of string literals with escape sequences
+    Arena strings;
+    // bytes of the payloads in strings that no token points to anymore, relex_edit compacts
+    // the arena once they add up
+    u64 unused_string_bytes = 0;
+
+    void reserve(s64 wanted);
+    Token *add(void);
+    void release(void);
+};
+
+// byte offsets of the first character of every line.
+// build can be called again for another source, the table is reused when it is big enough
+struct LineTable
+{
+    u32 *starts = null;
+    s64 count = 0;
+    s64 allocated = 0;
+
+    void build(String source);
+    void resolve(u32 offset, int *line, int *col);
+    void release(void);
+};
+
+struct InternTable;
+
+// position in the token sequence, see Lexer::mark
+typedef u64 TokenMark;
+
 struct Lexer
 {
+    // @note the input is always followed by LEXER_INPUT_PADDING zero bytes,
+    // so scanning loops stop on the 0 sentinel instead of checking bounds
     String input;
-    u64 input_cursor = 0;
+    char *input_cursor = null;
+    char *input_end = null;
+    Arena input_copy; // padded copy of inputs that came without padding
+
+    // decoded string literals go to string_arena when the caller supplies one, otherwise
+    // to decoded_strings which initialize resets, so they live until the next input
+    Arena *string_arena = null;
+    Arena decoded_strings;
 
     int current_line_number     = 0;
     int current_character_index = 0;
     int total_lines_processed   = 0;
     int last_line_number = 0;
 
-    char token_buffer[MAX_TOKEN_SIZE];
+    // peek_token generates into a ring of ring_mask + 1 tokens, 'tokens' when ring is null.
+    // LookaheadLexer supplies a bigger one
     Token tokens[TOTAL_TOKEN_COUNT];
+    Token *ring = null;
+    int ring_mask = TOTAL_TOKEN_COUNT - 1;
+    char *token_start = null;
     int token_cursor = 0;
+    // when set, tokens are appended here instead of going through the ring
+    TokenArray *token_output = null;
     int number_of_tokens = 0;
+    // tokens eaten since the oldest mark stay in the ring, so rewinding does not lex them again
+    u64 tokens_eaten = 0;
+    u64 oldest_mark = 0;
+    int mark_count = 0;
     Token eof;
     
-    b8 should_stop_processing = false;
+    // @note errors never stop the lexer, they are counted and, when there is a
+    // diagnostics list, recorded in it for the caller to emit.
+    // the lexer itself prints nothing: without a list only error_count tells that there were
+    // errors. set one and call Diagnostics::emit to see them, like the demo in main.cpp does
+    int error_count = 0;
+    Diagnostics *diagnostics = null;
+    u32 file_id = 0;
+    // when set, a token with an error comes out as TokenType_ERROR spanning the bad text
+    // and lexing picks up again right after it
+    b8 recover_errors = false;
+    b8 scalar_numbers = false; // @debug digit by digit number parsing, to check the SWAR paths against
+    b8 hand_written_operators = false; // @debug the switch the operator DFA replaced, to check it against
+    InternTable *interner = null; // when set, identifiers are interned into it
+    // when cleared only byte offsets are kept while lexing, the line and column fields of
+    // tokens are not meaningful and resolve_position computes them from source_offset instead
+    b8 track_positions = true;
+    LineTable line_starts; // of the input, built by the first resolve_position
 
-    b8 initialize(String source);
+    // @note can be called again to reuse the lexer (and its buffers) for another input
+    b8 initialize(String source, b8 is_padded = false);
+    void deinitialize(void);
     Token *peek_next_token(void);
     Token *peek_token(int index);
     Token *generate_token(void);
+    Token *scan_token(void);
+    Token *scan_operator(void);
+    Token *scan_operator_by_hand(int c);
+    void recover(Token *token);
     void eat_token(void);
+    // marks nest, rewinding to a mark or dropping it releases it.
+    // @note the ring has to hold every token from the oldest mark to the furthest peek
+    TokenMark mark(void);
+    void rewind(TokenMark mark);
+    void drop_mark(TokenMark mark);
     Token *get_unused_token(void);
+    b8 tokenize(TokenArray *out);
+    void resolve_position(u32 offset, int *line, int *col);
 
     void eat_character(void);
     int peek_next_character(void);
@@ -142,6 +252,7 @@ struct Lexer
 
     void set_token_position(Token *token);
     void set_token_end(Token *token);
+    void skip_to(const char *target, ScanLines *lines);
     void eat_until_new_line(void);
     void eat_block_comment(void);
 
@@ -157,7 +268,7 @@ struct Lexer
     int parse_hexadecimal_digit(void);
     TokenType check_for_keyword(Token *token);
 
-    void report_error(Token *pos, const char *format, ...);
+    void report_error(Token *pos, DiagnosticCode code, s64 argument = 0);
 };
 
 enum LiteralNumber
@@ -168,5 +279,57 @@ enum LiteralNumber
     LiteralNumber_FLOAT       = 0x4,
 };
 
+// columnar token storage, one entry per token in each array.
+// line and column are computed from the line table when a Token is requested
+struct TokenStore
+{
+    u16 *types   = null;
+    u32 *offsets = null;
+    u32 *lengths = null;
+    s64 count = 0;
+    s64 allocated = 0;
+
+    String source;
+    LineTable lines;
+
+    void add(TokenType type, u32 offset, u32 length);
+    // @note the name of the returned token is the raw source text of the token
+    Token get_token(s64 index);
+    u64 memory_size(void);
+    void release(void);
+};
+
+// lexes the whole source in one pass, the end of file token is included.
+// returns false if any lexical error was reported, or without lexing anything when the
+// source is 4GB or larger, which does not fit the u32 token offsets
+b8 tokenize_all(String source, TokenArray *out, b8 is_padded = false, Diagnostics *diagnostics = null);
+
+// splits the source at new lines and lexes the pieces on thread_count threads.
+// the tokens are the same as the ones tokenize_all produces, sources of 4GB and more are
+// rejected the same way
+b8 tokenize_parallel(String source, TokenArray *out, int thread_count, b8 is_padded = false, Diagnostics *diagnostics = null);
+
+// replace deleted_length bytes at offset with inserted_length new ones
+struct TextEdit
+{
+    u64 offset = 0;
+    u64 deleted_length = 0;
+    u64 inserted_length = 0;
+};
+
+// updates tokens lexed from old_source to match new_source, which is old_source with the edit
+// applied and padded like any other input. only the tokens around the edit are lexed again,
+// the ones behind it are shifted. new_source may be old_source edited in place, otherwise the
+// names of all tokens are moved over to it. returns false if the re-lexed text has errors.
+// @note shifting the tokens behind the edit is O(tokens after the edit), an edit at the top of
+// a 50k line file takes about half a millisecond. positions relative to anchors would make it
+// O(tokens re-lexed) but every user of source_offset and line/col would have to resolve them
+b8 relex_edit(TokenArray *tokens, String old_source, String new_source, TextEdit edit);
+
+b8 build_token_store(String source, TokenStore *out, b8 is_padded = false);
+
+// copies source into the arena followed by LEXER_INPUT_PADDING zero bytes
+String pad_input(String source, Arena *arena);
+
 // @debug
 const char *token_type_strings(TokenType type);
\ No newline at end of file
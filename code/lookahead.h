@@ -0,0 +1,36 @@
+#pragma once
+
+#include "common.h"
+#include "lexer.h"
+
+// a Lexer with a ring of N tokens, for parsers that look further ahead than TOTAL_TOKEN_COUNT
+// or back up to a mark. N is a power of two, peek sees up to N - 1 tokens past the current one,
+// fewer while a mark holds on to the tokens eaten since it was set.
+// @note names of tokens point into the input or the lexer's decoded strings, never into the
+// ring, so they stay valid until the lexer is initialized again no matter how far ahead it gets.
+// the Lexer points into the ring, keep the LookaheadLexer in place once it is initialized
+template <int N>
+struct LookaheadLexer
+{
+    static_assert((N >= 2) && ((N & (N - 1)) == 0), "the lookahead ring has to be a power of two");
+
+    Lexer lexer;
+    Token ring[N];
+
+    b8 initialize(String source, b8 is_padded = false)
+    {
+        if (!lexer.initialize(source, is_padded)) return false;
+        lexer.ring = ring;
+        lexer.ring_mask = N - 1;
+        return true;
+    }
+
+    void deinitialize(void) { lexer.deinitialize(); }
+
+    Token *peek(int index = 0) { return lexer.peek_token(index); }
+    void eat(void) { lexer.eat_token(); }
+
+    TokenMark mark(void) { return lexer.mark(); }
+    void rewind(TokenMark mark) { lexer.rewind(mark); }
+    void drop_mark(TokenMark mark) { lexer.drop_mark(mark); }
+};
\ No newline at end of file
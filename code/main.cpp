@@ -1,9 +1,83 @@
 #include "lexer.h"
+#include "platform.h"
+#include "driver.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-int main(void)
+#define DEFAULT_POPULATE_THRESHOLD (64ull * 1024 * 1024)
+
+static int lex_and_report(int count, char **paths, int thread_count, u64 populate_threshold)
+{
+    LexedFile *files = (LexedFile*)calloc(count, sizeof(LexedFile));
+    for (int i = 0; i < count; ++i)
+    {
+        files[i] = LexedFile();
+        files[i].path = paths[i];
+    }
+
+    f64 start = get_wall_clock();
+    int result = lex_files(files, count, thread_count, populate_threshold) ? 0 : -1;
+    f64 elapsed = get_wall_clock() - start;
+
+    // reported in command line order no matter which worker got to a file first
+    TextBuffer errors;
+    u64 total_bytes = 0;
+    s64 total_tokens = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        LexedFile *file = &files[i];
+        file->diagnostics.format(&errors, paths);
+        if (!file->could_open)
+        {
+            errors.append("%s: Error: Could not open file.\n", file->path);
+        }
+        else
+        {
+            f64 megabytes = (f64)file->file.contents.length / (1024.0 * 1024.0);
+            fprintf(stdout, "%s: %llu bytes, %lld tokens, %.2f MB/s, %.0f tokens/s\n",
+                    file->path, file->file.contents.length, file->tokens.count,
+                    megabytes / file->seconds, (f64)file->tokens.count / file->seconds);
+
+            total_bytes += file->file.contents.length;
+            total_tokens += file->tokens.count;
+        }
+        release_lexed_file(file);
+    }
+    free(files);
+
+    // all errors go out in one write
+    if (errors.length) fwrite(errors.data, 1, errors.length, stderr);
+    errors.release();
+
+    if (count > 1)
+    {
+        f64 megabytes = (f64)total_bytes / (1024.0 * 1024.0);
+        fprintf(stdout, "total: %llu bytes, %lld tokens, %d threads, %.2f MB/s, %.0f tokens/s\n",
+                total_bytes, total_tokens, thread_count, megabytes / elapsed, (f64)total_tokens / elapsed);
+    }
+    return result;
+}
+
+int main(int argc, char **argv)
 {
+    if (argc > 1)
+    {
+        // lexer [--populate-mb N] [--threads N] file...
+        u64 populate_threshold = DEFAULT_POPULATE_THRESHOLD;
+        int thread_count = get_processor_count();
+        int first = 1;
+        while (first + 1 < argc)
+        {
+            if (strcmp(argv[first], "--populate-mb") == 0) populate_threshold = strtoull(argv[first + 1], null, 10) * 1024 * 1024;
+            else if (strcmp(argv[first], "--threads") == 0) thread_count = atoi(argv[first + 1]);
+            else break;
+            first += 2;
+        }
+        return lex_and_report(argc - first, argv + first, thread_count, populate_threshold);
+    }
+
     String input;
     char source_code_memory[] = R"(
     /**
@@ -26,8 +100,11 @@ int main(void)
     input.length = sizeof(source_code_memory);
     input.data = source_code_memory;
 
+    // the lexer does not print errors, they are collected here and emitted at the end
+    Diagnostics diagnostics;
     Lexer lexer;
     if (!lexer.initialize(input)) return -1;
+    lexer.diagnostics = &diagnostics;
 
     while (true)
     {
@@ -60,6 +137,9 @@ int main(void)
     }
 
     printf("\nLexer:\nTotal lines processed: %d\n", lexer.total_lines_processed);
+    diagnostics.emit(stderr);
+    diagnostics.release();
 
+    lexer.deinitialize();
     return 0;
 }
\ No newline at end of file
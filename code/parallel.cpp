@@ -0,0 +1,244 @@
+#include "lexer.h"
+#include "platform.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+// below this a piece is not worth a thread
+#define PARALLEL_MIN_CHUNK_SIZE (256 * 1024)
+#define PARALLEL_MAX_THREADS 64
+
+// @note the only lexer state that crosses a new line is being inside a block comment
+// (strings end at a new line), so every piece is lexed speculatively as if it
+// started outside of one. while stitching, the token the previous piece stopped at
+// is looked up in the next piece: when it is there the lexers agree from that point
+// on, when it is not the text in between is lexed again from the correct position.
+// a piece with errors is lexed again the same way up to its last error, only errors
+// found then are real.
+struct LexChunk
+{
+    String source;
+    u64 begin = 0;
+    u64 end = 0;
+
+    TokenArray tokens;
+    u64 next_start = 0;     // first token start at or after 'end'
+    u64 new_line_count = 0; // in [begin, end)
+    u64 errors_end = 0;     // past the last error, which might only come from the wrong state
+    b8 needs_serial = false;
+};
+
+static u64 count_new_lines(const char *at, const char *end)
+{
+    return scan.count_new_lines(at, end - at);
+}
+
+static void lex_chunk(void *data)
+{
+    LexChunk *chunk = (LexChunk*)data;
+    b8 is_last = chunk->end == chunk->source.length;
+
+    Lexer lexer;
+    lexer.initialize(chunk->source, true);
+    lexer.input_cursor = chunk->source.data + chunk->begin;
+    lexer.token_output = &chunk->tokens;
+    lexer.string_arena = &chunk->tokens.strings;
+
+    chunk->tokens.reserve((s64)((chunk->end - chunk->begin) / 4) + 1);
+    chunk->new_line_count = count_new_lines(chunk->source.data + chunk->begin, chunk->source.data + chunk->end);
+
+    int error_count = 0;
+    while (true)
+    {
+        Token *token = lexer.generate_token();
+        if (lexer.error_count != error_count)
+        {
+            error_count = lexer.error_count;
+            chunk->errors_end = (u64)(lexer.input_cursor - chunk->source.data);
+        }
+
+        if (token->type == TokenType_END_OF_FILE)
+        {
+            // a zero byte inside the input ends the file early
+            if (token->source_offset < chunk->source.length) chunk->needs_serial = true;
+            chunk->next_start = token->source_offset;
+            if (!is_last) chunk->tokens.count -= 1;
+            break;
+        }
+        if (token->source_offset >= chunk->end)
+        {
+            chunk->next_start = token->source_offset;
+            chunk->tokens.count -= 1;
+            break;
+        }
+    }
+}
+
+static s64 find_token(TokenArray *tokens, u64 offset)
+{
+    s64 low = 0;
+    s64 high = tokens->count;
+    while (low < high)
+    {
+        s64 middle = (low + high) / 2;
+        if (tokens->data[middle].source_offset < offset) low = middle + 1;
+        else high = middle;
+    }
+    if ((low < tokens->count) && (tokens->data[low].source_offset == offset)) return low;
+    return -1;
+}
+
+static void append_tokens(TokenArray *out, LexChunk *chunk, s64 first, int line_base)
+{
+    s64 count = chunk->tokens.count - first;
+    out->reserve(out->count + count);
+    for (s64 i = first; i < chunk->tokens.count; ++i)
+    {
+        Token *token = &out->data[out->count++];
+        *token = chunk->tokens.data[i];
+        token->line_start += line_base;
+        token->line_end   += line_base;
+    }
+}
+
+b8 tokenize_parallel(String source, TokenArray *out, int thread_count, b8 is_padded, Diagnostics *diagnostics)
+{
+    // offsets are stored as u32, past 4GB they would wrap and the pieces could not be stitched
+    if (source.length > 0xFFFFFFFF) return false;
+
+    if (!is_padded) source = pad_input(source, &out->strings);
+    if (!source.data) return false;
+
+    if (thread_count > PARALLEL_MAX_THREADS) thread_count = PARALLEL_MAX_THREADS;
+    u64 max_chunks = source.length / PARALLEL_MIN_CHUNK_SIZE;
+    if ((u64)thread_count > max_chunks) thread_count = (int)max_chunks;
+    if (thread_count <= 1) return tokenize_all(source, out, true, diagnostics);
+
+    LexChunk chunks[PARALLEL_MAX_THREADS];
+    int chunk_count = 0;
+
+    // split right after a new line close to every 1/thread_count of the input
+    u64 begin = 0;
+    for (int i = 1; i <= thread_count; ++i)
+    {
+        u64 end = source.length;
+        if (i < thread_count)
+        {
+            u64 target = source.length / thread_count * i;
+            if (target <= begin) continue;
+            const char *new_line = (const char*)memchr(source.data + target, '\n', source.length - target);
+            if (!new_line) end = source.length;
+            else end = (new_line - source.data) + 1;
+        }
+        if (end <= begin) continue;
+
+        LexChunk *chunk = &chunks[chunk_count++];
+        chunk->source = source;
+        chunk->begin = begin;
+        chunk->end = end;
+        begin = end;
+        if (end == source.length) break;
+    }
+
+    Thread threads[PARALLEL_MAX_THREADS];
+    for (int i = 1; i < chunk_count; ++i)
+    {
+        if (!start_thread(&threads[i], lex_chunk, &chunks[i])) lex_chunk(&chunks[i]);
+    }
+    lex_chunk(&chunks[0]);
+    for (int i = 1; i < chunk_count; ++i)
+    {
+        if (threads[i].handle) join_thread(&threads[i]);
+    }
+
+    // the first piece starts in the right state, its errors are real
+    b8 needs_serial = chunks[0].errors_end != 0;
+    for (int i = 0; i < chunk_count; ++i)
+    {
+        if (chunks[i].needs_serial) needs_serial = true;
+    }
+
+    s64 first_output = out->count;
+    int line_bases[PARALLEL_MAX_THREADS];
+    line_bases[0] = 0;
+    for (int i = 1; i < chunk_count; ++i)
+    {
+        line_bases[i] = line_bases[i - 1] + (int)chunks[i - 1].new_line_count;
+    }
+
+    // stitch, 'expected' is always the start of a token the serial lexer would produce
+    u64 expected = 0;
+    int chunk_index = 0;
+    while (!needs_serial && (chunk_index < chunk_count))
+    {
+        LexChunk *chunk = &chunks[chunk_index];
+        if ((expected >= chunk->end) && (chunk->end < source.length))
+        {
+            // nothing in this piece is a token start
+            chunk_index += 1;
+            continue;
+        }
+
+        s64 first = (expected >= chunk->errors_end) ? find_token(&chunk->tokens, expected) : -1;
+        if (first >= 0)
+        {
+            append_tokens(out, chunk, first, line_bases[chunk_index]);
+            expected = chunk->next_start;
+            chunk_index += 1;
+            continue;
+        }
+
+        // the piece was lexed in the wrong state or has errors, lex again from 'expected'
+        // until we land on a token start the piece has as well, behind its errors.
+        // errors now are real ones, the serial lexer reports them in order
+        const char *line_start = source.data + expected;
+        while ((line_start > source.data + chunk->begin) && (line_start[-1] != '\n')) --line_start;
+
+        Lexer lexer;
+        lexer.initialize(source, true);
+        lexer.input_cursor = source.data + expected;
+        lexer.current_line_number = line_bases[chunk_index] + 1 + (int)count_new_lines(source.data + chunk->begin, line_start);
+        lexer.current_character_index = (int)((source.data + expected) - line_start) + 1;
+        lexer.token_output = out;
+        lexer.string_arena = &out->strings;
+
+        while (true)
+        {
+            Token *token = lexer.generate_token();
+            if (lexer.error_count)
+            {
+                needs_serial = true;
+                break;
+            }
+            if (token->type == TokenType_END_OF_FILE)
+            {
+                chunk_index = chunk_count;
+                break;
+            }
+
+            while ((chunk_index < chunk_count) && (token->source_offset >= chunks[chunk_index].end)) chunk_index += 1;
+            assert(chunk_index < chunk_count);
+            LexChunk *next = &chunks[chunk_index];
+            if ((token->source_offset >= next->errors_end) && (find_token(&next->tokens, token->source_offset) >= 0))
+            {
+                expected = token->source_offset;
+                out->count -= 1;
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < chunk_count; ++i)
+    {
+        out->strings.take_blocks(&chunks[i].tokens.strings);
+        chunks[i].tokens.release();
+    }
+
+    if (needs_serial)
+    {
+        out->count = first_output;
+        return tokenize_all(source, out, true, diagnostics);
+    }
+    return true;
+}
\ No newline at end of file
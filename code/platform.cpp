@@ -0,0 +1,346 @@
+#include "platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+u64 get_cycle_count(void)
+{
+#if defined(_M_X64) || defined(__x86_64__)
+    return __rdtsc();
+#else
+    // nanoseconds, close enough to a cycle count to compare runs on the same machine
+    return (u64)(get_wall_clock() * 1e9);
+#endif
+}
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+
+f64 get_wall_clock(void)
+{
+    static LARGE_INTEGER frequency;
+    if (!frequency.QuadPart) QueryPerformanceFrequency(&frequency);
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (f64)counter.QuadPart / (f64)frequency.QuadPart;
+}
+
+// reads the file into a zeroed heap buffer with room for the padding
+static b8 read_file(HANDLE file, u64 size, MappedFile *out, u64 padding)
+{
+    char *data = (char*)calloc(1, size + padding);
+    if (!data) return false;
+
+    u64 done = 0;
+    while (done < size)
+    {
+        u64 left = size - done;
+        DWORD chunk = (left > 0x40000000) ? 0x40000000 : (DWORD)left;
+        DWORD read = 0;
+        if (!ReadFile(file, data + done, chunk, &read, null) || !read)
+        {
+            free(data);
+            return false;
+        }
+        done += read;
+    }
+
+    out->contents.data = data;
+    out->contents.length = size;
+    out->base = data;
+    out->mapped_size = size + padding;
+    out->is_mapped = false;
+    return true;
+}
+
+b8 map_file(const char *path, MappedFile *out, u64 padding, u64 populate_threshold)
+{
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, null, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, null);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    u64 size = (u64)file_size.QuadPart;
+    u64 page_size = info.dwPageSize;
+    u64 total = (size + page_size - 1) & ~(page_size - 1);
+
+    // @note a view can't be followed by memory of our own at page granularity, views and
+    // allocations start on 64k boundaries. the rest of the last page of a view is zero filled
+    // though, so the view is used as it is when that covers the padding. empty files and
+    // files that end within 'padding' bytes of a page boundary are read into a heap buffer
+    if (!size || (total - size < padding))
+    {
+        b8 result = read_file(file, size, out, padding);
+        CloseHandle(file);
+        return result;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, null, PAGE_READONLY, 0, 0, null);
+    CloseHandle(file);
+    if (!mapping) return false;
+
+    void *base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    // the view keeps the mapping alive
+    CloseHandle(mapping);
+    if (!base) return false;
+
+#if defined(_WIN32_WINNT) && (_WIN32_WINNT >= 0x0602)
+    if (size >= populate_threshold)
+    {
+        // best effort, faults the pages in up front like MAP_POPULATE
+        WIN32_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = base;
+        range.NumberOfBytes = (SIZE_T)size;
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+#else
+    (void)populate_threshold;
+#endif
+
+    out->contents.data = (char*)base;
+    out->contents.length = size;
+    out->base = base;
+    out->mapped_size = total;
+    out->is_mapped = true;
+    return true;
+}
+
+void unmap_file(MappedFile *file)
+{
+    if (file->is_mapped) UnmapViewOfFile(file->base);
+    else free(file->base);
+    *file = MappedFile();
+}
+
+static DWORD WINAPI thread_entry(LPVOID parameter)
+{
+    Thread *thread = (Thread*)parameter;
+    thread->proc(thread->data);
+    return 0;
+}
+
+b8 start_thread(Thread *thread, ThreadProc *proc, void *data)
+{
+    thread->proc = proc;
+    thread->data = data;
+    HANDLE handle = CreateThread(null, 0, thread_entry, thread, 0, null);
+    if (!handle) return false;
+    thread->handle = (u64)handle;
+    return true;
+}
+
+void join_thread(Thread *thread)
+{
+    WaitForSingleObject((HANDLE)thread->handle, INFINITE);
+    CloseHandle((HANDLE)thread->handle);
+    thread->handle = 0;
+}
+
+s64 atomic_load(volatile s64 *source)
+{
+    // @note volatile reads have acquire semantics with msvc
+    return *source;
+}
+
+s64 atomic_compare_exchange(volatile s64 *destination, s64 expected, s64 value)
+{
+    return InterlockedCompareExchange64((volatile LONG64*)destination, value, expected);
+}
+
+int get_processor_count(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+}
+
+u64 get_peak_memory(void)
+{
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return (u64)counters.PeakWorkingSetSize;
+}
+
+void reset_peak_memory(void)
+{
+}
+
+#else
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <pthread.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+f64 get_wall_clock(void)
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (f64)now.tv_sec + (f64)now.tv_nsec * 1e-9;
+}
+
+b8 map_file(const char *path, MappedFile *out, u64 padding, u64 populate_threshold)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    u64 size = (u64)info.st_size;
+    u64 page_size = (u64)sysconf(_SC_PAGESIZE);
+    u64 total = (size + padding + page_size - 1) & ~(page_size - 1);
+
+    // @note reserve zeroed anonymous memory for the file plus the padding, then map
+    // the file over the start of it. the tail of the last file page is zero filled
+    // by the kernel and the pages after it are the anonymous ones
+    void *base = mmap(null, total, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+
+    if (size)
+    {
+        int flags = MAP_PRIVATE | MAP_FIXED;
+        b8 is_large = size >= populate_threshold;
+        if (is_large) flags |= MAP_POPULATE;
+
+        void *mapped = mmap(base, size, PROT_READ, flags, fd, 0);
+        if (mapped == MAP_FAILED)
+        {
+            munmap(base, total);
+            close(fd);
+            return false;
+        }
+
+        madvise(base, size, MADV_SEQUENTIAL);
+#if defined(MADV_HUGEPAGE)
+        // best effort, only honoured where the kernel supports huge pages for file mappings
+        if (is_large) madvise(base, size, MADV_HUGEPAGE);
+#endif
+    }
+    close(fd);
+
+    out->contents.data = (char*)base;
+    out->contents.length = size;
+    out->base = base;
+    out->mapped_size = total;
+    out->is_mapped = true;
+    return true;
+}
+
+void unmap_file(MappedFile *file)
+{
+    if (file->base) munmap(file->base, file->mapped_size);
+    *file = MappedFile();
+}
+
+static void *thread_entry(void *parameter)
+{
+    Thread *thread = (Thread*)parameter;
+    thread->proc(thread->data);
+    return null;
+}
+
+b8 start_thread(Thread *thread, ThreadProc *proc, void *data)
+{
+    thread->proc = proc;
+    thread->data = data;
+
+    pthread_t handle;
+    if (pthread_create(&handle, null, thread_entry, thread) != 0) return false;
+    thread->handle = (u64)handle;
+    return true;
+}
+
+void join_thread(Thread *thread)
+{
+    pthread_join((pthread_t)thread->handle, null);
+    thread->handle = 0;
+}
+
+s64 atomic_load(volatile s64 *source)
+{
+    return __atomic_load_n(source, __ATOMIC_ACQUIRE);
+}
+
+s64 atomic_compare_exchange(volatile s64 *destination, s64 expected, s64 value)
+{
+    return __sync_val_compare_and_swap(destination, expected, value);
+}
+
+int get_processor_count(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (int)count : 1;
+}
+
+u64 get_peak_memory(void)
+{
+    // VmHWM follows reset_peak_memory, ru_maxrss does not
+    u64 result = 0;
+    FILE *file = fopen("/proc/self/status", "r");
+    if (file)
+    {
+        char line[256];
+        while (fgets(line, sizeof(line), file))
+        {
+            unsigned long long kilobytes;
+            if (sscanf(line, "VmHWM: %llu kB", &kilobytes) == 1)
+            {
+                result = kilobytes * 1024;
+                break;
+            }
+        }
+        fclose(file);
+    }
+    if (result) return result;
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return (u64)usage.ru_maxrss * 1024;
+}
+
+void reset_peak_memory(void)
+{
+#if defined(__GLIBC__)
+    // freed heap memory stays resident until it is handed back
+    malloc_trim(0);
+#endif
+
+    // "5" sets the peak back to the current resident size
+    int fd = open("/proc/self/clear_refs", O_WRONLY);
+    if (fd < 0) return;
+    ssize_t written = write(fd, "5", 1);
+    (void)written;
+    close(fd);
+}
+
+#endif
\ No newline at end of file
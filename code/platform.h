@@ -0,0 +1,48 @@
+#pragma once
+
+#include "common.h"
+#include "lexer.h"
+
+// wall clock time in seconds, only meaningful as a difference
+f64 get_wall_clock(void);
+// time stamp counter on x64, it ticks at a fixed rate and not with the actual clock of the core
+u64 get_cycle_count(void);
+
+// highest resident memory of the process in bytes since start or since the last reset.
+// @note resetting is only supported on linux, elsewhere the peak is the one of the whole process
+u64 get_peak_memory(void);
+void reset_peak_memory(void);
+
+// read only view of a whole file, followed by at least 'padding' zero bytes
+struct MappedFile
+{
+    String contents;
+
+    void *base = null;
+    u64 mapped_size = 0;
+    b8 is_mapped = false; // false when the file had to be read into memory
+};
+
+// files of at least populate_threshold bytes are faulted in up front.
+// @note on windows a view can't be followed by pages of our own, the file is mapped only when
+// the zero filled rest of its last page covers the padding and read into memory otherwise
+b8 map_file(const char *path, MappedFile *out, u64 padding, u64 populate_threshold);
+void unmap_file(MappedFile *file);
+
+typedef void ThreadProc(void *data);
+
+// @note the Thread is handed to the new thread, it must stay in place until joined
+struct Thread
+{
+    u64 handle = 0;
+    ThreadProc *proc = null;
+    void *data = null;
+};
+
+b8 start_thread(Thread *thread, ThreadProc *proc, void *data);
+void join_thread(Thread *thread);
+int get_processor_count(void);
+
+s64 atomic_load(volatile s64 *source);
+// returns the value *destination had before, the exchange happened when that equals 'expected'
+s64 atomic_compare_exchange(volatile s64 *destination, s64 expected, s64 value);
\ No newline at end of file
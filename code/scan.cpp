@@ -0,0 +1,350 @@
+#include "scan.h"
+#include "char_class.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SCAN_X86 1
+#include <immintrin.h>
+#else
+#define SCAN_X86 0
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_AVX2
+inline int count_bits(u32 x)         { return __popcnt(x); }
+inline int lowest_bit_index(u32 x)   { unsigned long index; _BitScanForward(&index, x); return (int)index; }
+inline int highest_bit_index(u32 x)  { unsigned long index; _BitScanReverse(&index, x); return (int)index; }
+#else
+#define TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+inline int count_bits(u32 x)         { return __builtin_popcount(x); }
+inline int lowest_bit_index(u32 x)   { return __builtin_ctz(x); }
+inline int highest_bit_index(u32 x)  { return 31 - __builtin_clz(x); }
+#endif
+
+// new lines before bit 'stop' of a block starting at 'at'
+inline void count_lines(ScanLines *lines, const char *at, u32 new_lines, int stop)
+{
+    if (stop < 32) new_lines &= (1u << stop) - 1;
+    if (!new_lines) return;
+    lines->count += count_bits(new_lines);
+    lines->last_line_start = at + highest_bit_index(new_lines) + 1;
+}
+
+/////////////////////////////////////////////////////////
+// scalar
+static const char *skip_whitespace_scalar(const char *at, ScanLines *lines)
+{
+    while (is_whitespace(*at))
+    {
+        if (*at == '\n')
+        {
+            lines->count += 1;
+            lines->last_line_start = at + 1;
+        }
+        ++at;
+    }
+    return at;
+}
+
+static const char *find_line_end_scalar(const char *at)
+{
+    while ((*at != '\n') && (*at != 0)) ++at;
+    return at;
+}
+
+static const char *find_block_comment_end_scalar(const char *at, ScanLines *lines)
+{
+    while (*at)
+    {
+        if ((at[0] == '*') && (at[1] == '/')) return at;
+        if (*at == '\n')
+        {
+            lines->count += 1;
+            lines->last_line_start = at + 1;
+        }
+        ++at;
+    }
+    return at;
+}
+
+static u64 count_new_lines_scalar(const char *at, u64 length)
+{
+    u64 result = 0;
+    for (u64 i = 0; i < length; ++i) result += (at[i] == '\n');
+    return result;
+}
+
+static u32 *find_line_starts_scalar(const char *at, u64 length, u32 offset, u32 *out)
+{
+    for (u64 i = 0; i < length; ++i)
+    {
+        if (at[i] == '\n') *out++ = offset + (u32)i + 1;
+    }
+    return out;
+}
+
+#if SCAN_X86
+/////////////////////////////////////////////////////////
+// sse2, always available on x64
+static const char *skip_whitespace_sse2(const char *at, ScanLines *lines)
+{
+    const __m128i space    = _mm_set1_epi8(' ');
+    const __m128i tab      = _mm_set1_epi8('\t');
+    const __m128i range    = _mm_set1_epi8('\r' - '\t');
+    const __m128i new_line = _mm_set1_epi8('\n');
+
+    while (true)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)at);
+        // '\t'..'\r' is checked as an unsigned range
+        __m128i shifted = _mm_sub_epi8(v, tab);
+        __m128i in_range = _mm_cmpeq_epi8(_mm_min_epu8(shifted, range), shifted);
+        __m128i white = _mm_or_si128(in_range, _mm_cmpeq_epi8(v, space));
+
+        // the 0 sentinel is not whitespace, so this always ends in the padding
+        u32 other = ~(u32)_mm_movemask_epi8(white) & 0xFFFF;
+        u32 new_lines = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(v, new_line));
+        if (other)
+        {
+            int index = lowest_bit_index(other);
+            count_lines(lines, at, new_lines, index);
+            return at + index;
+        }
+        count_lines(lines, at, new_lines, 32);
+        at += 16;
+    }
+}
+
+static const char *find_line_end_sse2(const char *at)
+{
+    const __m128i new_line = _mm_set1_epi8('\n');
+    const __m128i zero     = _mm_setzero_si128();
+
+    while (true)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)at);
+        u32 mask = (u32)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, new_line), _mm_cmpeq_epi8(v, zero)));
+        if (mask) return at + lowest_bit_index(mask);
+        at += 16;
+    }
+}
+
+static const char *find_block_comment_end_sse2(const char *at, ScanLines *lines)
+{
+    const __m128i star     = _mm_set1_epi8('*');
+    const __m128i slash    = _mm_set1_epi8('/');
+    const __m128i new_line = _mm_set1_epi8('\n');
+    const __m128i zero     = _mm_setzero_si128();
+
+    while (true)
+    {
+        // the second load reads one byte further
+        __m128i v    = _mm_loadu_si128((const __m128i*)at);
+        __m128i next = _mm_loadu_si128((const __m128i*)(at + 1));
+        __m128i end  = _mm_and_si128(_mm_cmpeq_epi8(v, star), _mm_cmpeq_epi8(next, slash));
+        u32 mask = (u32)_mm_movemask_epi8(_mm_or_si128(end, _mm_cmpeq_epi8(v, zero)));
+        u32 new_lines = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(v, new_line));
+        if (mask)
+        {
+            int index = lowest_bit_index(mask);
+            count_lines(lines, at, new_lines, index);
+            return at + index;
+        }
+        count_lines(lines, at, new_lines, 32);
+        at += 16;
+    }
+}
+
+// the tails shorter than a block go through the scalar versions
+static u64 count_new_lines_sse2(const char *at, u64 length)
+{
+    const __m128i new_line = _mm_set1_epi8('\n');
+
+    u64 result = 0;
+    u64 i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(at + i));
+        result += count_bits((u32)_mm_movemask_epi8(_mm_cmpeq_epi8(v, new_line)));
+    }
+    return result + count_new_lines_scalar(at + i, length - i);
+}
+
+static u32 *find_line_starts_sse2(const char *at, u64 length, u32 offset, u32 *out)
+{
+    const __m128i new_line = _mm_set1_epi8('\n');
+
+    u64 i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(at + i));
+        u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(v, new_line));
+        while (mask)
+        {
+            *out++ = offset + (u32)i + lowest_bit_index(mask) + 1;
+            mask &= mask - 1;
+        }
+    }
+    return find_line_starts_scalar(at + i, length - i, offset + (u32)i, out);
+}
+
+/////////////////////////////////////////////////////////
+// avx2
+TARGET_AVX2 static const char *skip_whitespace_avx2(const char *at, ScanLines *lines)
+{
+    const __m256i space    = _mm256_set1_epi8(' ');
+    const __m256i tab      = _mm256_set1_epi8('\t');
+    const __m256i range    = _mm256_set1_epi8('\r' - '\t');
+    const __m256i new_line = _mm256_set1_epi8('\n');
+
+    while (true)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)at);
+        __m256i shifted = _mm256_sub_epi8(v, tab);
+        __m256i in_range = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, range), shifted);
+        __m256i white = _mm256_or_si256(in_range, _mm256_cmpeq_epi8(v, space));
+
+        u32 other = ~(u32)_mm256_movemask_epi8(white);
+        u32 new_lines = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, new_line));
+        if (other)
+        {
+            int index = lowest_bit_index(other);
+            count_lines(lines, at, new_lines, index);
+            return at + index;
+        }
+        count_lines(lines, at, new_lines, 32);
+        at += 32;
+    }
+}
+
+TARGET_AVX2 static const char *find_line_end_avx2(const char *at)
+{
+    const __m256i new_line = _mm256_set1_epi8('\n');
+    const __m256i zero     = _mm256_setzero_si256();
+
+    while (true)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)at);
+        u32 mask = (u32)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, new_line), _mm256_cmpeq_epi8(v, zero)));
+        if (mask) return at + lowest_bit_index(mask);
+        at += 32;
+    }
+}
+
+TARGET_AVX2 static const char *find_block_comment_end_avx2(const char *at, ScanLines *lines)
+{
+    const __m256i star     = _mm256_set1_epi8('*');
+    const __m256i slash    = _mm256_set1_epi8('/');
+    const __m256i new_line = _mm256_set1_epi8('\n');
+    const __m256i zero     = _mm256_setzero_si256();
+
+    while (true)
+    {
+        __m256i v    = _mm256_loadu_si256((const __m256i*)at);
+        __m256i next = _mm256_loadu_si256((const __m256i*)(at + 1));
+        __m256i end  = _mm256_and_si256(_mm256_cmpeq_epi8(v, star), _mm256_cmpeq_epi8(next, slash));
+        u32 mask = (u32)_mm256_movemask_epi8(_mm256_or_si256(end, _mm256_cmpeq_epi8(v, zero)));
+        u32 new_lines = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, new_line));
+        if (mask)
+        {
+            int index = lowest_bit_index(mask);
+            count_lines(lines, at, new_lines, index);
+            return at + index;
+        }
+        count_lines(lines, at, new_lines, 32);
+        at += 32;
+    }
+}
+
+TARGET_AVX2 static u64 count_new_lines_avx2(const char *at, u64 length)
+{
+    const __m256i new_line = _mm256_set1_epi8('\n');
+
+    u64 result = 0;
+    u64 i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(at + i));
+        result += count_bits((u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, new_line)));
+    }
+    return result + count_new_lines_scalar(at + i, length - i);
+}
+
+TARGET_AVX2 static u32 *find_line_starts_avx2(const char *at, u64 length, u32 offset, u32 *out)
+{
+    const __m256i new_line = _mm256_set1_epi8('\n');
+
+    u64 i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(at + i));
+        u32 mask = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, new_line));
+        while (mask)
+        {
+            *out++ = offset + (u32)i + lowest_bit_index(mask) + 1;
+            mask &= mask - 1;
+        }
+    }
+    return find_line_starts_scalar(at + i, length - i, offset + (u32)i, out);
+}
+
+static b8 cpu_has_avx2(void)
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    __cpuid(info, 1);
+    b8 os_saves_ymm = ((info[2] & (1 << 27)) != 0) && ((_xgetbv(0) & 0x6) == 0x6);
+    if (!os_saves_ymm) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+#endif
+}
+#endif
+
+/////////////////////////////////////////////////////////
+ScanKernels get_scalar_scan_kernels(void)
+{
+    ScanKernels result;
+    result.name = "scalar";
+    result.skip_whitespace = skip_whitespace_scalar;
+    result.find_line_end = find_line_end_scalar;
+    result.find_block_comment_end = find_block_comment_end_scalar;
+    result.count_new_lines = count_new_lines_scalar;
+    result.find_line_starts = find_line_starts_scalar;
+    return result;
+}
+
+static ScanKernels select_scan_kernels(void)
+{
+    ScanKernels result = get_scalar_scan_kernels();
+#if SCAN_X86
+    if (cpu_has_avx2())
+    {
+        result.name = "avx2";
+        result.skip_whitespace = skip_whitespace_avx2;
+        result.find_line_end = find_line_end_avx2;
+        result.find_block_comment_end = find_block_comment_end_avx2;
+        result.count_new_lines = count_new_lines_avx2;
+        result.find_line_starts = find_line_starts_avx2;
+    }
+    else
+    {
+        result.name = "sse2";
+        result.skip_whitespace = skip_whitespace_sse2;
+        result.find_line_end = find_line_end_sse2;
+        result.find_block_comment_end = find_block_comment_end_sse2;
+        result.count_new_lines = count_new_lines_sse2;
+        result.find_line_starts = find_line_starts_sse2;
+    }
+#endif
+    return result;
+}
+
+ScanKernels scan = select_scan_kernels();
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "common.h"
+
+// Bulk scanning kernels used by the lexer to skip whitespace and comments.
+// Every kernel counts the new lines it walks over: lines->count is incremented
+// and lines->last_line_start is set to the first byte after the last '\n' seen.
+// @note there are no bounds, the kernels rely on the input ending with at least
+// LEXER_INPUT_PADDING zero bytes. every kernel stops on a 0 byte and never
+// reads further than 33 bytes past it
+struct ScanLines
+{
+    u64 count = 0;
+    const char *last_line_start = null;
+};
+
+struct ScanKernels
+{
+    const char *name;
+
+    // first byte that is not ' ', '\t', '\n', '\v', '\f' or '\r'
+    const char *(*skip_whitespace)(const char *at, ScanLines *lines);
+    // first '\n' or '\0', new lines are not counted since we stop on the first one
+    const char *(*find_line_end)(const char *at);
+    // the '*' of the first "*/", or the first '\0'
+    const char *(*find_block_comment_end)(const char *at, ScanLines *lines);
+
+    // @note unlike the kernels above these two are bounded by length, don't stop
+    // on a 0 byte and never read past at + length
+    // number of '\n' in [at, at + length)
+    u64 (*count_new_lines)(const char *at, u64 length);
+    // writes offset + 1 + the index of every '\n' in [at, at + length) to out,
+    // returns one past the last entry written
+    u32 *(*find_line_starts)(const char *at, u64 length, u32 offset, u32 *out);
+};
+
+// picked at startup from what the cpu supports
+extern ScanKernels scan;
+
+ScanKernels get_scalar_scan_kernels(void);
\ No newline at end of file
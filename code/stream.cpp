@@ -0,0 +1,254 @@
+#include "stream.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// a token that ends closer than this to the end of the buffered text could still grow,
+// the makers look at up to two characters after a token ('1..')
+#define STREAM_LOOKAHEAD 2
+
+void StreamLexer::initialize(u32 file_id, Diagnostics *diagnostics)
+{
+    release();
+    lexer = Lexer();
+    lexer.file_id = file_id;
+    lexer.diagnostics = &pending;
+    this->diagnostics = diagnostics;
+    lexer.current_line_number = 1;
+    lexer.current_character_index = 1;
+    lexer.string_arena = &scratch;
+
+    comment = StreamComment_NONE;
+    ended = false;
+    stream_offset = 0;
+    length = 0;
+}
+
+// points the lexer at the buffer without touching its line and column
+static void attach_buffer(StreamLexer *stream)
+{
+    stream->lexer.input.data = stream->buffer;
+    stream->lexer.input.length = stream->length;
+    stream->lexer.input_cursor = stream->buffer;
+    stream->lexer.input_end = stream->buffer + stream->length;
+}
+
+static void append_input(StreamLexer *stream, const char *data, u64 size)
+{
+    u64 wanted = stream->length + size + LEXER_INPUT_PADDING;
+    if (wanted > stream->allocated)
+    {
+        u64 new_allocated = stream->allocated ? stream->allocated * 2 : 64 * 1024;
+        while (new_allocated < wanted) new_allocated *= 2;
+
+        char *new_buffer = (char*)realloc(stream->buffer, new_allocated);
+        assert(new_buffer);
+        stream->buffer = new_buffer;
+        stream->allocated = new_allocated;
+    }
+
+    memcpy(stream->buffer + stream->length, data, size);
+    stream->length += size;
+    memset(stream->buffer + stream->length, 0, LEXER_INPUT_PADDING);
+    attach_buffer(stream);
+}
+
+// errors of a token that turned out complete are kept
+static void flush_errors(StreamLexer *stream)
+{
+    if (stream->diagnostics)
+    {
+        for (s64 i = 0; i < stream->pending.count; ++i)
+        {
+            stream->pending.data[i].offset = (u32)(stream->pending.data[i].offset + stream->stream_offset);
+        }
+        stream->diagnostics->take(&stream->pending);
+    }
+    stream->pending.count = 0;
+}
+
+// the token is final: make it independent of the buffer.
+// @note any token can have a name in the buffer (keywords, errors), not only literals, and
+// decoded strings are in the scratch arena which the next token resets
+static void keep_token(StreamLexer *stream, Token *token, TokenArray *out)
+{
+    if (token->name.data)
+    {
+        token->name.data = out->strings.copy_string(token->name.data, token->name.length);
+    }
+    token->source_offset = (u32)(token->source_offset + stream->stream_offset);
+}
+
+// skips a comment that started in an earlier piece, false when it goes on past the buffer
+static b8 continue_comment(StreamLexer *stream, b8 is_final)
+{
+    Lexer *lexer = &stream->lexer;
+    const char *end = lexer->input_end;
+    ScanLines lines;
+
+    if (stream->comment == StreamComment_LINE)
+    {
+        const char *at = scan.find_line_end(lexer->input_cursor);
+        lexer->skip_to(at, &lines);
+        if ((at >= end) && !is_final) return false;
+    }
+    else if (stream->comment == StreamComment_BLOCK)
+    {
+        const char *at = scan.find_block_comment_end(lexer->input_cursor, &lines);
+        while ((*at == 0) && (at < end))
+        {
+            at = scan.find_block_comment_end(at + 1, &lines);
+        }
+
+        if (at >= end)
+        {
+            if (is_final)
+            {
+                lexer->skip_to(at, &lines);
+                lexer->set_token_end(&lexer->eof);
+                lexer->report_error(&lexer->eof, Diagnostic_UNTERMINATED_COMMENT);
+            }
+            else
+            {
+                // a '*' at the very end might be the start of "*/"
+                if ((at > lexer->input_cursor) && (at[-1] == '*')) --at;
+                lexer->skip_to(at, &lines);
+                return false;
+            }
+        }
+        else
+        {
+            lexer->skip_to(at, &lines);
+            lexer->eat_character();
+            lexer->eat_character();
+        }
+    }
+
+    stream->comment = StreamComment_NONE;
+    return true;
+}
+
+// skips whitespace and comments up to the next token, false when the buffer runs out first
+static b8 skip_to_token(StreamLexer *stream)
+{
+    Lexer *lexer = &stream->lexer;
+    while (true)
+    {
+        if (!continue_comment(stream, false)) return false;
+
+        ScanLines lines;
+        lexer->skip_to(scan.skip_whitespace(lexer->input_cursor, &lines), &lines);
+        if (lexer->input_cursor >= lexer->input_end) return false;
+
+        if (lexer->input_cursor[0] != '/') return true;
+        if (lexer->input_cursor + 1 >= lexer->input_end) return false; // "/" or "//" or "/*"
+
+        char next = lexer->input_cursor[1];
+        if (next == '/') stream->comment = StreamComment_LINE;
+        else if (next == '*') stream->comment = StreamComment_BLOCK;
+        else return true;
+
+        lexer->eat_character();
+        lexer->eat_character();
+    }
+}
+
+b8 StreamLexer::feed(const char *data, u64 size, TokenArray *out)
+{
+    if (ended) return !lexer.error_count;
+    append_input(this, data, size);
+
+    while (skip_to_token(this))
+    {
+        // everything the lexer does for this token can still be taken back
+        char *cursor = lexer.input_cursor;
+        int line = lexer.current_line_number;
+        int column = lexer.current_character_index;
+        int last_line = lexer.last_line_number;
+        int total_lines = lexer.total_lines_processed;
+        int error_count = lexer.error_count;
+
+        scratch.reset();
+        pending.count = 0;
+        lexer.token_output = out;
+        Token *token = lexer.generate_token();
+        lexer.token_output = null;
+
+        if (token->type == TokenType_END_OF_FILE)
+        {
+            // a zero byte inside the input
+            flush_errors(this);
+            keep_token(this, token, out);
+            ended = true;
+            break;
+        }
+
+        if (lexer.input_cursor + STREAM_LOOKAHEAD > lexer.input_end)
+        {
+            out->count -= 1;
+            lexer.input_cursor = cursor;
+            lexer.current_line_number = line;
+            lexer.current_character_index = column;
+            lexer.last_line_number = last_line;
+            lexer.total_lines_processed = total_lines;
+            lexer.error_count = error_count;
+            pending.count = 0;
+            break;
+        }
+
+        flush_errors(this);
+        keep_token(this, token, out);
+    }
+
+    // keep only what is not lexed yet
+    u64 consumed = lexer.input_cursor - buffer;
+    memmove(buffer, buffer + consumed, length - consumed);
+    length -= consumed;
+    stream_offset += consumed;
+    memset(buffer + length, 0, LEXER_INPUT_PADDING);
+    attach_buffer(this);
+
+    return !lexer.error_count;
+}
+
+b8 StreamLexer::finish(TokenArray *out)
+{
+    if (!ended)
+    {
+        append_input(this, "", 0);
+        continue_comment(this, true);
+
+        // the rest of the input is all there is, the lexer can take it from here
+        lexer.token_output = out;
+        lexer.string_arena = &out->strings;
+        while (true)
+        {
+            Token *token = lexer.generate_token();
+            token->source_offset = (u32)(token->source_offset + stream_offset);
+            // decoded strings already went to the output's arena, every other name is in the buffer
+            if (token->name.data && (token->name.data >= buffer) && (token->name.data < buffer + allocated))
+            {
+                token->name.data = out->strings.copy_string(token->name.data, token->name.length);
+            }
+            if (token->type == TokenType_END_OF_FILE) break;
+        }
+        lexer.token_output = null;
+        lexer.string_arena = &scratch;
+        flush_errors(this);
+        ended = true;
+    }
+    return !lexer.error_count;
+}
+
+void StreamLexer::release(void)
+{
+    lexer.deinitialize();
+    free(buffer);
+    buffer = null;
+    length = 0;
+    allocated = 0;
+    pending.release();
+    scratch.release();
+}
\ No newline at end of file
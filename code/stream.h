@@ -0,0 +1,41 @@
+#pragma once
+
+#include "common.h"
+#include "arena.h"
+#include "lexer.h"
+
+enum StreamComment
+{
+    StreamComment_NONE,
+    StreamComment_LINE,
+    StreamComment_BLOCK,
+};
+
+// push style lexing of input that arrives in pieces.
+// @note only the text of the token that is not complete yet is kept between calls,
+// comments are skipped as they arrive. token offsets count from the start of the stream
+// and the names of returned tokens are copied into the arena of the output array.
+struct StreamLexer
+{
+    Lexer lexer;
+
+    // unfinished text from the last feed followed by the new piece, zero padded
+    char *buffer = null;
+    u64 length = 0;
+    u64 allocated = 0;
+    u64 stream_offset = 0; // of buffer[0]
+
+    StreamComment comment = StreamComment_NONE;
+    b8 ended = false; // a zero byte ends the input, like it does for Lexer
+
+    Diagnostics *diagnostics = null; // of the whole stream, offsets count from its start
+    Diagnostics pending;             // errors of the token being lexed, dropped if it is incomplete
+    Arena scratch;                   // decoded strings of the token being lexed
+
+    void initialize(u32 file_id = 0, Diagnostics *diagnostics = null);
+    // appends every token that is complete to 'out'
+    b8 feed(const char *data, u64 size, TokenArray *out);
+    // end of the input, lexes the rest and appends the end of file token
+    b8 finish(TokenArray *out);
+    void release(void);
+};
\ No newline at end of file